@@ -0,0 +1,162 @@
+#include "headers/aggregate.h"
+
+// clusters are cut from the body bvh rather than a separate octree, the
+// hierarchy is already refit every step and its nodes bound the bodies
+
+static void reserve_aggregates(_app *p_app) {
+	u32 object_count = p_app->bvh.object_count;
+	if (object_count <= p_app->aggregate.object_max && p_app->aggregate.nodes != NULL) return;
+
+	u32 node_max = 2 * object_count + 1;
+	p_app->aggregate.nodes = realloc(p_app->aggregate.nodes, sizeof(_aggregate_node) * node_max);
+	p_app->aggregate.frontier = realloc(p_app->aggregate.frontier, sizeof(u32) * node_max);
+	p_app->aggregate.impostors = realloc(p_app->aggregate.impostors, sizeof(_billboard) * node_max);
+	p_app->aggregate.resolved = realloc(p_app->aggregate.resolved, sizeof(u32) * (object_count + 1));
+	p_app->aggregate.node_max = node_max;
+	p_app->aggregate.object_max = object_count;
+}
+
+static void accumulate_nodes(_app *p_app) {
+	for (u32 i = p_app->bvh.node_count; i-- > 0;) {
+		_bvh_node *node = &p_app->bvh.nodes[i];
+		_aggregate_node *agg = &p_app->aggregate.nodes[i];
+
+		if (node->count == 0) {
+			_aggregate_node *left = &p_app->aggregate.nodes[node->left_first];
+			_aggregate_node *right = &p_app->aggregate.nodes[node->left_first + 1];
+			glm_vec3_add(left->weighted_position, right->weighted_position, agg->weighted_position);
+			glm_vec3_add(left->weighted_colour, right->weighted_colour, agg->weighted_colour);
+			agg->weight = left->weight + right->weight;
+			agg->luminosity = left->luminosity + right->luminosity;
+			continue;
+		}
+
+		*agg = (_aggregate_node){0};
+		for (u32 j = 0; j < node->count; j++) {
+			_solar_object *obj = &p_app->obj.solar_objects[p_app->bvh.indices[node->left_first + j]];
+			float weight = obj->intensity > 0.0f ? obj->intensity : 1.0f;
+
+			vec3 colour = {
+				(float)((obj->colour_id >> 16) & 0xFF),
+				(float)((obj->colour_id >> 8) & 0xFF),
+				(float)(obj->colour_id & 0xFF),
+			};
+
+			glm_vec3_muladds(obj->position, weight, agg->weighted_position);
+			glm_vec3_muladds(colour, weight, agg->weighted_colour);
+			agg->weight += weight;
+			agg->luminosity += obj->intensity > 0.0f ? obj->intensity : p_app->config.aggregate.reflected_intensity;
+		}
+	}
+}
+
+static _billboard generate_impostor(_bvh_node *node, _aggregate_node *agg) {
+	float inv_weight = 1.0f / agg->weight;
+	float radius = 0.5f * glm_vec3_distance(node->min, node->max);
+
+	u32 r = (u32)(agg->weighted_colour[0] * inv_weight);
+	u32 g = (u32)(agg->weighted_colour[1] * inv_weight);
+	u32 b = (u32)(agg->weighted_colour[2] * inv_weight);
+
+	_billboard billboard = {
+		.light_pos_w = {
+			.position = {
+				agg->weighted_position[0] * inv_weight,
+				agg->weighted_position[1] * inv_weight,
+				agg->weighted_position[2] * inv_weight,
+			},
+			.intensity = agg->luminosity,
+		},
+		// size is the full width of the quad, the cluster spans the diameter
+		.size = {2.0f * radius, 2.0f * radius},
+		.rotation = {0.0f, 0.0f},
+		.light_data = {
+			.colour_id = (clamp(r, 0, 255) << 16) | (clamp(g, 0, 255) << 8) | clamp(b, 0, 255),
+		},
+		.type = BILLBOARD_TYPE_LIGHT,
+		.shape = BILLBOARD_SHAPE_CIRCLE,
+		.location = BILLBOARD_LOCATION_IN_WORLD,
+		.object_index = UINT32_MAX,
+	};
+
+	return billboard;
+}
+
+void create_aggregates(_app *p_app) {
+	p_app->aggregate = (_app_aggregate){0};
+	reserve_aggregates(p_app);
+}
+
+void update_aggregates(_app *p_app) {
+	p_app->aggregate.resolved_count = 0;
+	p_app->aggregate.impostor_count = 0;
+	p_app->obj.primitive_count = 0;
+
+	if (p_app->bvh.node_count == 0) return;
+
+	reserve_aggregates(p_app);
+	accumulate_nodes(p_app);
+
+	float pixel_scale = (float)p_app->swp.extent.height / (2.0f * tanf(glm_rad(p_app->view.fov_y) * 0.5f));
+	u32 max_primitives = p_app->config.aggregate.max_primitives ? p_app->config.aggregate.max_primitives : 1;
+
+	// breadth first refinement, every queued node still owes at least one
+	// primitive so emitted + pending never passes the budget
+	u32 *frontier = p_app->aggregate.frontier;
+	u32 head = 0, tail = 0;
+	u32 pending = 1;
+	u32 emitted = 0;
+	frontier[tail++] = 0;
+
+	while (head < tail) {
+		u32 node_index = frontier[head++];
+		_bvh_node *node = &p_app->bvh.nodes[node_index];
+		pending--;
+
+		vec3 centre;
+		glm_vec3_center(node->min, node->max, centre);
+		float radius = 0.5f * glm_vec3_distance(node->min, node->max);
+		float distance = glm_vec3_distance(centre, p_app->view.camera_pos);
+		float pixels = distance > radius ? radius / distance * pixel_scale : FLT_MAX;
+
+		u32 budget = max_primitives - (emitted + pending);
+
+		// a lone body costs one primitive either way and its box radius is
+		// about 1.7x its own, so it is always resolved and left to the
+		// visibility pass to draw as a point once it is below point_pixels
+		if (node->count == 1) {
+			p_app->aggregate.resolved[p_app->aggregate.resolved_count++] = p_app->bvh.indices[node->left_first];
+			emitted++;
+			continue;
+		}
+
+		if (pixels >= p_app->config.aggregate.cluster_pixels) {
+			if (node->count && node->count <= budget) {
+				for (u32 i = 0; i < node->count; i++) {
+					p_app->aggregate.resolved[p_app->aggregate.resolved_count++] = p_app->bvh.indices[node->left_first + i];
+				}
+				emitted += node->count;
+				continue;
+			}
+			if (node->count == 0 && budget >= 2) {
+				frontier[tail++] = node->left_first;
+				frontier[tail++] = node->left_first + 1;
+				pending += 2;
+				continue;
+			}
+		}
+
+		p_app->aggregate.impostors[p_app->aggregate.impostor_count++] = generate_impostor(node, &p_app->aggregate.nodes[node_index]);
+		emitted++;
+	}
+
+	p_app->obj.primitive_count = emitted;
+}
+
+void destroy_aggregates(_app *p_app) {
+	free(p_app->aggregate.nodes);
+	free(p_app->aggregate.frontier);
+	free(p_app->aggregate.resolved);
+	free(p_app->aggregate.impostors);
+	p_app->aggregate = (_app_aggregate){0};
+}
@@ -1,5 +1,6 @@
 #include "headers/app.h"
 #include "headers/maths.h"
+#include "headers/spirv.h"
 
 void app_init(_app *p_app) {
 
@@ -9,19 +10,46 @@ void app_init(_app *p_app) {
 	p_app->config.win.flags = CONFIG_FLAG_NONE;
 	p_app->config.win.render_extent_modifier = 0.33f;
 
-	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[0] = 16;
-	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[1] = 32;
-	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[2] = 64;
-	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[3] = 128;
-	p_app->config.lod.MESH_SPHERE_LOD_RINGS[0] = 16;
-	p_app->config.lod.MESH_SPHERE_LOD_RINGS[1] = 32;
-	p_app->config.lod.MESH_SPHERE_LOD_RINGS[2] = 64;
-	p_app->config.lod.MESH_SPHERE_LOD_RINGS[3] = 128;
-	p_app->config.lod.MESH_SPHERE_LOD_DISTANCES[0] = 2500.0f;
-	p_app->config.lod.MESH_SPHERE_LOD_DISTANCES[1] = 6400.0f;
-	p_app->config.lod.MESH_SPHERE_LOD_DISTANCES[2] = 10000.0f;
+	// more frames in flight trade latency for throughput, one waits for the
+	// gpu every frame
+	p_app->config.sync.frames_in_flight = 2;
+
+	p_app->config.cache.directory = "cache";
+
+	// the lens starts on the low variant and moves to this one once it has
+	// compiled in the background
+	p_app->config.lens.quality = LENS_QUALITY_MEDIUM;
+
+	// lods run coarse to fine, rings cover half the angle segments do so
+	// half as many keep the facets square
+	p_app->config.lod.count = 6;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[0] = 8;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[1] = 12;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[2] = 16;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[3] = 32;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[4] = 64;
+	p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[5] = 128;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[0] = 4;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[1] = 6;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[2] = 8;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[3] = 16;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[4] = 32;
+	p_app->config.lod.MESH_SPHERE_LOD_RINGS[5] = 64;
+	p_app->config.lod.error_pixels = 0.5f;
+	p_app->config.lod.hysteresis = 0.15f;
+	// spheres up to this projected radius are ray traced on a quad, 0 keeps
+	// every body on its mesh
+	p_app->config.lod.impostor_pixels = 256.0f;
 	p_app->config.lod.MESH_SPHERE_LOD_RADIUS_MODIFIER = 1.0f;
 
+	p_app->config.aggregate.cluster_pixels = 2.0f;
+	p_app->config.aggregate.max_primitives = 8192;
+	// what a body that emits nothing adds to its cluster's brightness, a
+	// stand in for the light it reflects so planet clusters stay visible
+	p_app->config.aggregate.reflected_intensity = 1.0f;
+
+	p_app->config.visibility.point_pixels = 1.0f;
+
 	p_app->config.grid.range = 30.0f;
 	p_app->config.grid.spacing = 2.5f;
 	p_app->config.grid.seg_len = 0.05f;
@@ -29,15 +57,22 @@ void app_init(_app *p_app) {
 	p_app->config.grid.softening_multiplier = 0.25f;
 
 	p_app->sync.frame_index = 0;
+	p_app->sync.frames_in_flight = clamp(p_app->config.sync.frames_in_flight, 1, MAX_FRAMES_IN_FLIGHT);
 
-	p_app->shader.mesh_vert = "src/shaders/mesh.vert.spv";
-	p_app->shader.mesh_frag = "src/shaders/mesh.frag.spv";
-	p_app->shader.billboard_vert = "src/shaders/billboard.vert.spv";
-	p_app->shader.billboard_frag = "src/shaders/billboard.frag.spv";
-	p_app->shader.grid_vert = "src/shaders/grid.vert.spv";
-	p_app->shader.grid_frag = "src/shaders/grid.frag.spv";
-	p_app->shader.lens_vert = "src/shaders/lens.vert.spv";
-	p_app->shader.lens_frag = "src/shaders/lens.frag.spv";
+	p_app->shader.mesh_vert = SPIRV(mesh_vert);
+	p_app->shader.mesh_frag = SPIRV(mesh_frag);
+	p_app->shader.billboard_vert = SPIRV(billboard_vert);
+	p_app->shader.billboard_frag = SPIRV(billboard_frag);
+	p_app->shader.grid_vert = SPIRV(grid_vert);
+	p_app->shader.grid_frag = SPIRV(grid_frag);
+	p_app->shader.lens_vert = SPIRV(lens_vert);
+	p_app->shader.lens_frag = SPIRV(lens_frag);
+	p_app->shader.composite_frag = SPIRV(composite_frag);
+	p_app->shader.point_vert = SPIRV(point_vert);
+	p_app->shader.point_frag = SPIRV(point_frag);
+	p_app->shader.cull_comp = SPIRV(cull_comp);
+	p_app->shader.impostor_vert = SPIRV(impostor_vert);
+	p_app->shader.impostor_frag = SPIRV(impostor_frag);
 
 	glm_vec3_copy((vec3){10.0f, 10.0f, 10.0f}, p_app->view.camera_pos);
 	glm_vec3_copy((vec3){0.0f, 0.0f, 0.0f}, p_app->view.target);
@@ -53,6 +88,8 @@ void app_init(_app *p_app) {
 	p_app->view.pitch = 0.0f;
 	p_app->view.first_mouse = true;
 	p_app->view.mouse_locked = true;
+	p_app->view.focus_index = UINT32_MAX;
+	p_app->view.focus_distance_multiplier = 4.0f;
 
 	static _solar_object solar_objects[] = {
 		{
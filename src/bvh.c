@@ -0,0 +1,391 @@
+#include "headers/bvh.h"
+
+#define BVH_BIN_COUNT 16
+#define BVH_LEAF_SIZE 4
+#define BVH_STACK_SIZE 128
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_REBUILD_RATIO 1.3f
+#define BVH_MIN_DIRECTION 1.0e-20f
+
+// nodes are stored depth first with siblings adjacent, so a child always
+// sits after its parent and a reverse sweep refits bottom up. a traversal
+// holds at most one pending sibling per level plus the node it pops, so
+// the build stops splitting at BVH_MAX_DEPTH and no child is ever dropped
+#define BVH_MAX_DEPTH (BVH_STACK_SIZE - 1)
+
+typedef struct _bvh_bin {
+	vec3 min;
+	vec3 max;
+	u32 count;
+} _bvh_bin;
+
+static float half_area(vec3 min, vec3 max) {
+	float dx = max[0] - min[0];
+	float dy = max[1] - min[1];
+	float dz = max[2] - min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static void sphere_bounds(_solar_object *obj, vec3 min, vec3 max) {
+	for (u32 a = 0; a < 3; a++) {
+		min[a] = obj->position[a] - obj->radius;
+		max[a] = obj->position[a] + obj->radius;
+	}
+}
+
+static void leaf_bounds(_app *p_app, _bvh_node *node) {
+	glm_vec3_fill(node->min, FLT_MAX);
+	glm_vec3_fill(node->max, -FLT_MAX);
+
+	for (u32 i = 0; i < node->count; i++) {
+		vec3 min, max;
+		sphere_bounds(&p_app->obj.solar_objects[p_app->bvh.indices[node->left_first + i]], min, max);
+		glm_vec3_minv(node->min, min, node->min);
+		glm_vec3_maxv(node->max, max, node->max);
+	}
+}
+
+static void subdivide(_app *p_app, u32 node_index, u32 depth) {
+	_bvh_node *node = &p_app->bvh.nodes[node_index];
+	if (node->count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH) return;
+
+	vec3 centroid_min, centroid_max;
+	glm_vec3_fill(centroid_min, FLT_MAX);
+	glm_vec3_fill(centroid_max, -FLT_MAX);
+	for (u32 i = 0; i < node->count; i++) {
+		float *position = p_app->obj.solar_objects[p_app->bvh.indices[node->left_first + i]].position;
+		glm_vec3_minv(centroid_min, position, centroid_min);
+		glm_vec3_maxv(centroid_max, position, centroid_max);
+	}
+
+	float best_cost = FLT_MAX;
+	u32 best_axis = 0;
+	u32 best_split = 0;
+
+	for (u32 axis = 0; axis < 3; axis++) {
+		float extent = centroid_max[axis] - centroid_min[axis];
+		if (extent <= 0.0f) continue;
+
+		_bvh_bin bins[BVH_BIN_COUNT];
+		for (u32 b = 0; b < BVH_BIN_COUNT; b++) {
+			glm_vec3_fill(bins[b].min, FLT_MAX);
+			glm_vec3_fill(bins[b].max, -FLT_MAX);
+			bins[b].count = 0;
+		}
+
+		float scale = BVH_BIN_COUNT / extent;
+		for (u32 i = 0; i < node->count; i++) {
+			_solar_object *obj = &p_app->obj.solar_objects[p_app->bvh.indices[node->left_first + i]];
+			u32 b = (u32)((obj->position[axis] - centroid_min[axis]) * scale);
+			if (b >= BVH_BIN_COUNT) b = BVH_BIN_COUNT - 1;
+
+			vec3 min, max;
+			sphere_bounds(obj, min, max);
+			glm_vec3_minv(bins[b].min, min, bins[b].min);
+			glm_vec3_maxv(bins[b].max, max, bins[b].max);
+			bins[b].count++;
+		}
+
+		float left_area[BVH_BIN_COUNT - 1], right_area[BVH_BIN_COUNT - 1];
+		u32 left_count[BVH_BIN_COUNT - 1], right_count[BVH_BIN_COUNT - 1];
+		vec3 left_min, left_max, right_min, right_max;
+		glm_vec3_fill(left_min, FLT_MAX);
+		glm_vec3_fill(left_max, -FLT_MAX);
+		glm_vec3_fill(right_min, FLT_MAX);
+		glm_vec3_fill(right_max, -FLT_MAX);
+		u32 left_sum = 0, right_sum = 0;
+
+		for (u32 b = 0; b < BVH_BIN_COUNT - 1; b++) {
+			left_sum += bins[b].count;
+			left_count[b] = left_sum;
+			if (bins[b].count) {
+				glm_vec3_minv(left_min, bins[b].min, left_min);
+				glm_vec3_maxv(left_max, bins[b].max, left_max);
+			}
+			left_area[b] = left_sum ? half_area(left_min, left_max) : 0.0f;
+
+			u32 r = BVH_BIN_COUNT - 1 - b;
+			right_sum += bins[r].count;
+			right_count[r - 1] = right_sum;
+			if (bins[r].count) {
+				glm_vec3_minv(right_min, bins[r].min, right_min);
+				glm_vec3_maxv(right_max, bins[r].max, right_max);
+			}
+			right_area[r - 1] = right_sum ? half_area(right_min, right_max) : 0.0f;
+		}
+
+		for (u32 b = 0; b < BVH_BIN_COUNT - 1; b++) {
+			float cost = left_count[b] * left_area[b] + right_count[b] * right_area[b];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	float leaf_cost = node->count * half_area(node->min, node->max);
+	if (best_cost >= leaf_cost) return;
+
+	float scale = BVH_BIN_COUNT / (centroid_max[best_axis] - centroid_min[best_axis]);
+	i32 i = node->left_first;
+	i32 j = i + node->count - 1;
+	while (i <= j) {
+		u32 b = (u32)((p_app->obj.solar_objects[p_app->bvh.indices[i]].position[best_axis] - centroid_min[best_axis]) * scale);
+		if (b >= BVH_BIN_COUNT) b = BVH_BIN_COUNT - 1;
+
+		if (b <= best_split) {
+			i++;
+		} else {
+			u32 tmp = p_app->bvh.indices[i];
+			p_app->bvh.indices[i] = p_app->bvh.indices[j];
+			p_app->bvh.indices[j--] = tmp;
+		}
+	}
+
+	u32 left_count = i - node->left_first;
+	if (left_count == 0 || left_count == node->count) return;
+
+	u32 left_index = p_app->bvh.node_count;
+	p_app->bvh.node_count += 2;
+
+	_bvh_node *left = &p_app->bvh.nodes[left_index];
+	_bvh_node *right = &p_app->bvh.nodes[left_index + 1];
+	left->left_first = node->left_first;
+	left->count = left_count;
+	right->left_first = i;
+	right->count = node->count - left_count;
+	leaf_bounds(p_app, left);
+	leaf_bounds(p_app, right);
+
+	node->left_first = left_index;
+	node->count = 0;
+
+	subdivide(p_app, left_index, depth + 1);
+	subdivide(p_app, left_index + 1, depth + 1);
+}
+
+static float tree_cost(_app *p_app) {
+	if (p_app->bvh.node_count == 0) return 0.0f;
+
+	float cost = 0.0f;
+	for (u32 i = 0; i < p_app->bvh.node_count; i++) {
+		_bvh_node *node = &p_app->bvh.nodes[i];
+		float area = half_area(node->min, node->max);
+		cost += node->count ? node->count * area : BVH_TRAVERSAL_COST * area;
+	}
+
+	float root_area = half_area(p_app->bvh.nodes[0].min, p_app->bvh.nodes[0].max);
+	return root_area > 0.0f ? cost / root_area : 0.0f;
+}
+
+void create_bvh(_app *p_app) {
+	p_app->bvh.nodes = NULL;
+	p_app->bvh.indices = NULL;
+	p_app->bvh.node_count = 0;
+	p_app->bvh.object_count = 0;
+	p_app->bvh.build_cost = 0.0f;
+
+	build_bvh(p_app);
+}
+
+void build_bvh(_app *p_app) {
+	u32 count = p_app->obj.solar_object_count;
+
+	if (count != p_app->bvh.object_count || p_app->bvh.nodes == NULL) {
+		p_app->bvh.nodes = realloc(p_app->bvh.nodes, sizeof(_bvh_node) * (2 * count + 1));
+		p_app->bvh.indices = realloc(p_app->bvh.indices, sizeof(u32) * (count + 1));
+		for (u32 i = 0; i < count; i++) {
+			p_app->bvh.indices[i] = i;
+		}
+		p_app->bvh.object_count = count;
+	}
+
+	p_app->bvh.node_count = 0;
+	p_app->bvh.build_cost = 0.0f;
+	if (count == 0) return;
+
+	_bvh_node *root = &p_app->bvh.nodes[0];
+	root->left_first = 0;
+	root->count = count;
+	leaf_bounds(p_app, root);
+	p_app->bvh.node_count = 1;
+
+	subdivide(p_app, 0, 0);
+	p_app->bvh.build_cost = tree_cost(p_app);
+}
+
+void refit_bvh(_app *p_app) {
+	for (u32 i = p_app->bvh.node_count; i-- > 0;) {
+		_bvh_node *node = &p_app->bvh.nodes[i];
+
+		if (node->count) {
+			leaf_bounds(p_app, node);
+			continue;
+		}
+
+		_bvh_node *left = &p_app->bvh.nodes[node->left_first];
+		_bvh_node *right = &p_app->bvh.nodes[node->left_first + 1];
+		glm_vec3_minv(left->min, right->min, node->min);
+		glm_vec3_maxv(left->max, right->max, node->max);
+	}
+}
+
+void update_bvh(_app *p_app) {
+	if (p_app->bvh.object_count != p_app->obj.solar_object_count) {
+		build_bvh(p_app);
+		return;
+	}
+
+	refit_bvh(p_app);
+
+	// refitting keeps the topology, so once bodies drift far enough from
+	// where they were binned the tree is rebuilt
+	if (tree_cost(p_app) > p_app->bvh.build_cost * BVH_REBUILD_RATIO) {
+		build_bvh(p_app);
+	}
+}
+
+void destroy_bvh(_app *p_app) {
+	free(p_app->bvh.nodes);
+	p_app->bvh.nodes = NULL;
+	free(p_app->bvh.indices);
+	p_app->bvh.indices = NULL;
+	p_app->bvh.node_count = 0;
+	p_app->bvh.object_count = 0;
+}
+
+// an axis aligned ray would give an infinite reciprocal, and a slab plane
+// through the origin then makes 0 * inf = nan which no comparison rejects
+// or accepts reliably. a huge finite one keeps the slab test exact
+static float safe_reciprocal(float d) {
+	return fabsf(d) > BVH_MIN_DIRECTION ? 1.0f / d : copysignf(1.0f / BVH_MIN_DIRECTION, d);
+}
+
+static float ray_box(_bvh_node *node, vec3 origin, vec3 inv_direction, float max_t) {
+	float t_min = 0.0f;
+	float t_max = max_t;
+
+	for (u32 a = 0; a < 3; a++) {
+		float t0 = (node->min[a] - origin[a]) * inv_direction[a];
+		float t1 = (node->max[a] - origin[a]) * inv_direction[a];
+		if (t0 > t1) {
+			float tmp = t0;
+			t0 = t1;
+			t1 = tmp;
+		}
+		if (t0 > t_min) t_min = t0;
+		if (t1 < t_max) t_max = t1;
+	}
+
+	return t_min <= t_max ? t_min : FLT_MAX;
+}
+
+static float ray_sphere(_solar_object *obj, vec3 origin, vec3 direction) {
+	vec3 oc;
+	glm_vec3_sub(obj->position, origin, oc);
+
+	float tca = glm_vec3_dot(oc, direction);
+	float d2 = glm_vec3_dot(oc, oc) - tca * tca;
+	float r2 = obj->radius * obj->radius;
+	if (d2 > r2) return FLT_MAX;
+
+	float thc = sqrtf(r2 - d2);
+	float t = tca - thc;
+	if (t < 0.0f) t = tca + thc;
+	return t < 0.0f ? FLT_MAX : t;
+}
+
+// direction must be normalised, returns the closest body hit or UINT32_MAX
+u32 bvh_ray_cast(_app *p_app, vec3 origin, vec3 direction, float *out_t) {
+	u32 hit = UINT32_MAX;
+	float best_t = FLT_MAX;
+
+	if (p_app->bvh.node_count == 0) return hit;
+
+	vec3 inv_direction = {safe_reciprocal(direction[0]), safe_reciprocal(direction[1]), safe_reciprocal(direction[2])};
+
+	u32 stack[BVH_STACK_SIZE];
+	u32 stack_size = 0;
+	if (ray_box(&p_app->bvh.nodes[0], origin, inv_direction, best_t) != FLT_MAX) {
+		stack[stack_size++] = 0;
+	}
+
+	while (stack_size > 0) {
+		_bvh_node *node = &p_app->bvh.nodes[stack[--stack_size]];
+		if (ray_box(node, origin, inv_direction, best_t) == FLT_MAX) continue;
+
+		if (node->count) {
+			for (u32 i = 0; i < node->count; i++) {
+				u32 index = p_app->bvh.indices[node->left_first + i];
+				float t = ray_sphere(&p_app->obj.solar_objects[index], origin, direction);
+				if (t < best_t) {
+					best_t = t;
+					hit = index;
+				}
+			}
+			continue;
+		}
+
+		u32 near = node->left_first;
+		u32 far = node->left_first + 1;
+		float t_near = ray_box(&p_app->bvh.nodes[near], origin, inv_direction, best_t);
+		float t_far = ray_box(&p_app->bvh.nodes[far], origin, inv_direction, best_t);
+		if (t_far < t_near) {
+			u32 tmp = near;
+			near = far;
+			far = tmp;
+			float tmp_t = t_near;
+			t_near = t_far;
+			t_far = tmp_t;
+		}
+
+		// push the far child first so the near one is popped next
+		if (t_far != FLT_MAX) stack[stack_size++] = far;
+		if (t_near != FLT_MAX) stack[stack_size++] = near;
+	}
+
+	if (out_t) *out_t = best_t;
+	return hit;
+}
+
+// writes up to max_indices bodies whose spheres touch the query sphere and
+// returns the total number found
+u32 bvh_query_radius(_app *p_app, vec3 centre, float radius, u32 *out_indices, u32 max_indices) {
+	u32 found = 0;
+	if (p_app->bvh.node_count == 0) return found;
+
+	u32 stack[BVH_STACK_SIZE];
+	u32 stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		_bvh_node *node = &p_app->bvh.nodes[stack[--stack_size]];
+
+		float d2 = 0.0f;
+		for (u32 a = 0; a < 3; a++) {
+			float c = centre[a];
+			if (c < node->min[a]) d2 += (node->min[a] - c) * (node->min[a] - c);
+			else if (c > node->max[a]) d2 += (c - node->max[a]) * (c - node->max[a]);
+		}
+		if (d2 > radius * radius) continue;
+
+		if (node->count) {
+			for (u32 i = 0; i < node->count; i++) {
+				u32 index = p_app->bvh.indices[node->left_first + i];
+				_solar_object *obj = &p_app->obj.solar_objects[index];
+				float reach = radius + obj->radius;
+				if (glm_vec3_distance2(centre, obj->position) > reach * reach) continue;
+
+				if (found < max_indices) out_indices[found] = index;
+				found++;
+			}
+			continue;
+		}
+
+		stack[stack_size++] = node->left_first;
+		stack[stack_size++] = node->left_first + 1;
+	}
+
+	return found;
+}
@@ -202,31 +202,29 @@ bool is_physical_device_extensions_supported(VkPhysicalDevice physical_device) {
 void create_logical_device(_app *p_app) {
 	p_app->device.queue_indices = find_queue_families(p_app, p_app->device.physical);
 
-	u32 unique_queue_families[2] = {
+	u32 families[3] = {
 		p_app->device.queue_indices.graphics_family,
 		p_app->device.queue_indices.present_family,
+		p_app->device.queue_indices.transfer_family,
 	};
 
-	bool same_family = (unique_queue_families[0] == unique_queue_families[1]);
-
-	VkDeviceQueueCreateInfo queue_create_infos[2];
-	u32 queue_create_info_count = same_family ? 1 : 2;
+	VkDeviceQueueCreateInfo queue_create_infos[3];
+	u32 queue_create_info_count = 0;
 
 	float queue_priority = 1.0f;
 
-	queue_create_infos[0] = (VkDeviceQueueCreateInfo){
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = unique_queue_families[0],
-		.queueCount = 1,
-		.pQueuePriorities = &queue_priority,
-	};
+	for (u32 i = 0; i < 3; i++) {
+		bool seen = false;
+		for (u32 j = 0; j < i; j++) {
+			if (families[j] == families[i]) seen = true;
+		}
+		if (seen) continue;
 
-	if (!same_family) {
-		queue_create_infos[1] = (VkDeviceQueueCreateInfo){
+		queue_create_infos[queue_create_info_count++] = (VkDeviceQueueCreateInfo){
 			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			.queueFamilyIndex = unique_queue_families[1],
+			.queueFamilyIndex = families[i],
 			.queueCount = 1,
-			.pQueuePriorities = &queue_priority
+			.pQueuePriorities = &queue_priority,
 		};
 	}
 
@@ -234,11 +232,26 @@ void create_logical_device(_app *p_app) {
 	vkGetPhysicalDeviceFeatures(p_app->device.physical, &physical_device_features);
 	physical_device_features.samplerAnisotropy = VK_TRUE;
 	physical_device_features.robustBufferAccess = VK_FALSE;
+	p_app->device.multi_draw_indirect = physical_device_features.multiDrawIndirect == VK_TRUE;
+
+	// indirect draw count is optional, the cull draws fall back to a fixed
+	// count without it
+	VkPhysicalDeviceVulkan12Features supported_1_2 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+	};
+	VkPhysicalDeviceFeatures2 supported_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported_1_2,
+	};
+	vkGetPhysicalDeviceFeatures2(p_app->device.physical, &supported_features);
+	p_app->device.draw_indirect_count = supported_1_2.drawIndirectCount == VK_TRUE;
 
 	VkPhysicalDeviceVulkan12Features features_1_2 = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
 		.runtimeDescriptorArray = VK_TRUE,
 		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.drawIndirectCount = supported_1_2.drawIndirectCount,
+		.timelineSemaphore = VK_TRUE,
 	};
 
 	VkDeviceCreateInfo logical_device_create_info = {
@@ -269,6 +282,7 @@ void create_logical_device(_app *p_app) {
 
 	vkGetDeviceQueue(p_app->device.logical, p_app->device.queue_indices.graphics_family, 0, &p_app->device.graphics_queue);
 	vkGetDeviceQueue(p_app->device.logical, p_app->device.queue_indices.present_family, 0, &p_app->device.present_queue);
+	vkGetDeviceQueue(p_app->device.logical, p_app->device.queue_indices.transfer_family, 0, &p_app->device.transfer_queue);
 }
 void create_alloc(_app *p_app) {
 
@@ -325,6 +339,8 @@ void rate_physical_device_suitability(_candidates *p_candidate) {
 _queue_family_indices find_queue_families(_app *p_app, VkPhysicalDevice physical_device) {
 	_queue_family_indices indices;
 	indices.is_graphics_family_set = 0;
+	indices.is_present_family_set = 0;
+	indices.is_transfer_family_set = 0;
 
 	u32 queue_family_count = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, NULL);
@@ -344,6 +360,19 @@ _queue_family_indices find_queue_families(_app *p_app, VkPhysicalDevice physical
 			indices.present_family = i;
 			indices.is_present_family_set = 1;
 		}
+
+		// a transfer only family is the dma engine on most discrete gpus,
+		// copies there run beside rendering rather than between it
+		VkQueueFlags flags = queue_family_properties[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && !indices.is_transfer_family_set) {
+			indices.transfer_family = i;
+			indices.is_transfer_family_set = 1;
+		}
+	}
+
+	// without one the graphics queue takes the uploads too
+	if (!indices.is_transfer_family_set && indices.is_graphics_family_set) {
+		indices.transfer_family = indices.graphics_family;
 	}
 
 	return indices;
@@ -370,6 +399,24 @@ bool is_physical_device_suitable(_app *p_app, VkPhysicalDevice physical_device)
 		return false;
 	}
 
+	// frame pacing waits on a timeline semaphore, core in 1.2 but still a feature bit
+	VkPhysicalDeviceVulkan12Features supported_1_2 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+	};
+	VkPhysicalDeviceFeatures2 supported_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported_1_2,
+	};
+	vkGetPhysicalDeviceFeatures2(physical_device, &supported_features);
+	if (!supported_1_2.timelineSemaphore) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"physical device => lacks timeline semaphores"
+		);
+		return false;
+	}
+
 	_queue_family_indices indices = find_queue_families(p_app, physical_device);
 	if (indices.is_graphics_family_set == 0 || indices.is_present_family_set == 0) {
 		submit_debug_message(
@@ -0,0 +1,363 @@
+#include "headers/cull.h"
+#include "headers/validation.h"
+#include "headers/pipeline.h"
+#include "headers/buffer.h"
+#include "headers/deletion.h"
+#include "headers/descriptors.h"
+#include "headers/record.h"
+#include "headers/render_queue.h"
+
+// the sphere candidates left by classify_visibility are frustum tested and
+// bucketed by screen space error on the gpu. every entry of the mesh table,
+// the sphere lods and the impostor quad after them, owns a fixed region of
+// the culled instance buffer and one indirect command, so recording stays
+// the same handful of commands however many bodies there are
+
+// a uv sphere facet bulges off the true surface by r * (1 - cos(step / 2)),
+// so lod k is good enough while its projected radius keeps that under
+// config.lod.error_pixels. lod_pixels[k] is the largest radius in pixels
+// lod k may be drawn at before the next finer lod is needed
+static void calculate_lod_pixels(_app *p_app) {
+	for (u32 lod = 0; lod + 1 < p_app->mesh.impostor; lod++) {
+		float segment_half = (float)M_PI / (float)p_app->config.lod.MESH_SPHERE_LOD_SEGMENTS[lod];
+		float ring_half = (float)M_PI / (2.0f * (float)p_app->config.lod.MESH_SPHERE_LOD_RINGS[lod]);
+		float sagitta = 1.0f - cosf(fmaxf(segment_half, ring_half));
+		p_app->cull.lod_pixels[lod] = p_app->config.lod.error_pixels / sagitta;
+	}
+}
+
+void create_cull_descriptor_set_layout(_app *p_app) {
+	VkDescriptorSetLayoutBinding bindings[] = {
+		{ .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = 4, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = 5, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+	};
+
+	VkDescriptorSetLayoutCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+		.pBindings = bindings,
+	};
+
+	if (vkCreateDescriptorSetLayout(p_app->device.logical, &info, NULL, &p_app->cull.descriptor_set_layout) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "cull descriptor set layout => failed to create");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void create_cull_pipeline(_app *p_app) {
+	VkShaderModule comp = create_shader_module(p_app, p_app->shader.cull_comp);
+
+	VkPushConstantRange push_constant_range = {
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(_cull_push_constants),
+	};
+
+	VkPipelineLayoutCreateInfo layout_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &p_app->cull.descriptor_set_layout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &push_constant_range,
+	};
+
+	if (vkCreatePipelineLayout(p_app->device.logical, &layout_info, NULL, &p_app->cull.layout) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "cull pipeline layout => failed");
+		exit(EXIT_FAILURE);
+	}
+
+	VkComputePipelineCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = { .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_COMPUTE_BIT, .module = comp, .pName = "main" },
+		.layout = p_app->cull.layout,
+	};
+
+	if (create_cached_compute_pipeline(p_app, &info, &p_app->cull.pipeline) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "cull pipeline => failed");
+		exit(EXIT_FAILURE);
+	}
+
+	vkDestroyShaderModule(p_app->device.logical, comp, NULL);
+}
+
+static void create_cull_instance_buffer(_app *p_app, VkDeviceSize size, _mapped_buffer *p_buffer) {
+	create_buffer(p_app, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, &p_buffer->buffer, &p_buffer->allocation);
+	p_buffer->mapped = NULL;
+	p_buffer->size = size;
+}
+
+void create_cull_buffers(_app *p_app) {
+	VkDeviceSize instance_buffer_size = sizeof(u32) * p_app->mesh.count * (p_app->obj.solar_object_count + 1);
+	VkDeviceSize lod_state_size = sizeof(u32) * (p_app->obj.solar_object_count + 1);
+
+	p_app->cull.draws = malloc(sizeof(_mapped_buffer) * p_app->sync.frames_in_flight);
+	p_app->cull.instances = malloc(sizeof(_mapped_buffer) * p_app->sync.frames_in_flight);
+	p_app->cull.bound_lod_states = malloc(sizeof(VkBuffer) * p_app->sync.frames_in_flight);
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		create_mapped_buffer(p_app, sizeof(_cull_draws), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, &p_app->cull.draws[i]);
+		memset(p_app->cull.draws[i].mapped, 0, sizeof(_cull_draws));
+		create_cull_instance_buffer(p_app, instance_buffer_size, &p_app->cull.instances[i]);
+	}
+
+	// one state buffer for every slot, so each frame's hysteresis starts from
+	// the lods the frame before it picked. zero means none picked yet
+	create_mapped_buffer(p_app, lod_state_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &p_app->cull.lod_states);
+	memset(p_app->cull.lod_states.mapped, 0, p_app->cull.lod_states.size);
+
+	calculate_lod_pixels(p_app);
+}
+
+void create_cull_descriptor_pool(_app *p_app) {
+	VkDescriptorPoolSize sizes[] = {
+		{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = p_app->sync.frames_in_flight },
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = p_app->sync.frames_in_flight * 5 },
+	};
+
+	VkDescriptorPoolCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.poolSizeCount = sizeof(sizes) / sizeof(sizes[0]),
+		.pPoolSizes = sizes,
+		.maxSets = p_app->sync.frames_in_flight,
+	};
+
+	if (vkCreateDescriptorPool(p_app->device.logical, &info, NULL, &p_app->cull.pool) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "cull descriptor pool => failed to create");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void create_cull_descriptor_sets(_app *p_app) {
+	p_app->cull.sets = malloc(sizeof(VkDescriptorSet) * p_app->sync.frames_in_flight);
+	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * p_app->sync.frames_in_flight);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) layouts[i] = p_app->cull.descriptor_set_layout;
+
+	VkDescriptorSetAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = p_app->cull.pool,
+		.descriptorSetCount = p_app->sync.frames_in_flight,
+		.pSetLayouts = layouts,
+	};
+
+	if (vkAllocateDescriptorSets(p_app->device.logical, &alloc_info, p_app->cull.sets) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "cull descriptor sets => failed to allocate");
+		exit(EXIT_FAILURE);
+	}
+	free(layouts);
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		VkDescriptorBufferInfo ubo_info = {
+			.buffer = p_app->uniform.buffers[i],
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet ubo_write = {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->cull.sets[i],
+			.dstBinding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.pBufferInfo = &ubo_info,
+		};
+
+		vkUpdateDescriptorSets(p_app->device.logical, 1, &ubo_write, 0, NULL);
+		update_storage_descriptor(p_app, p_app->cull.sets[i], 1, p_app->storage.solar_objects[i].buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[i], 2, p_app->storage.instances[i].buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[i], 3, p_app->cull.instances[i].buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[i], 4, p_app->cull.draws[i].buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[i], 5, p_app->cull.lod_states.buffer);
+		p_app->cull.bound_lod_states[i] = p_app->cull.lod_states.buffer;
+
+		// the draws read the culled instances through binding 4 of the main set
+		update_storage_descriptor(p_app, p_app->descriptor.sets[i], 4, p_app->cull.instances[i].buffer);
+	}
+}
+
+// resets the frame's indirect commands, the instance counts are filled in by
+// the cull pass with atomics. the fence for this slot has been waited on, so
+// the counts it left behind are read back first as the triangles submitted
+void update_cull_buffers(_app *p_app, u32 frame_index) {
+	_cull_draws *draws = (_cull_draws*)p_app->cull.draws[frame_index].mapped;
+	_mapped_buffer *instances = &p_app->cull.instances[frame_index];
+	u32 draw_count = p_app->mesh.count;
+
+	p_app->perf.triangle_count = 0;
+	for (u32 draw = 0; draw < draw_count; draw++) {
+		p_app->perf.triangle_count += (uint64_t)draws->commands[draw].instanceCount * (draws->commands[draw].indexCount / 3);
+	}
+
+	// every draw gets room for all of this frame's candidates plus one, the
+	// cull shader relies on that and writes its atomic slots unchecked
+	VkDeviceSize required_size = sizeof(u32) * draw_count * (p_app->visibility.sphere_count + 1);
+
+	if (required_size > instances->size) {
+		defer_buffer_destruction(p_app, frame_index, instances->buffer, instances->allocation);
+		create_cull_instance_buffer(p_app, required_size * 2, instances);
+		update_storage_descriptor(p_app, p_app->cull.sets[frame_index], 3, instances->buffer);
+		update_storage_descriptor(p_app, p_app->descriptor.sets[frame_index], 4, instances->buffer);
+		invalidate_static_command_buffers(p_app, frame_index);
+	}
+
+	// a grown state buffer starts over, every body picks its lod fresh once.
+	// the other slots may still be in flight with the old one, so they move
+	// over when they come round again. the old buffer is retired with this
+	// slot, which is only reused after all of those have finished
+	_mapped_buffer *lod_states = &p_app->cull.lod_states;
+	if (grow_mapped_buffer(p_app, frame_index, lod_states, sizeof(u32) * (p_app->obj.solar_object_count + 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+		memset(lod_states->mapped, 0, lod_states->size);
+	}
+
+	if (p_app->cull.bound_lod_states[frame_index] != lod_states->buffer) {
+		update_storage_descriptor(p_app, p_app->cull.sets[frame_index], 5, lod_states->buffer);
+		p_app->cull.bound_lod_states[frame_index] = lod_states->buffer;
+	}
+
+	u32 capacity = (u32)(instances->size / (sizeof(u32) * draw_count));
+
+	for (u32 draw = 0; draw < draw_count; draw++) {
+		_mesh_range *range = &p_app->mesh.ranges[draw];
+		draws->commands[draw] = (VkDrawIndexedIndirectCommand){
+			.indexCount = range->index_count,
+			.instanceCount = 0,
+			.firstIndex = range->first_index,
+			.vertexOffset = range->vertex_offset,
+			.firstInstance = draw * capacity,
+		};
+		draws->draw_counts[draw] = 0;
+	}
+}
+
+void record_cull(_app *p_app, VkCommandBuffer command_buffer) {
+	u32 candidate_count = p_app->visibility.sphere_count;
+	if (candidate_count == 0) return;
+
+	float pixel_scale = (float)p_app->swp.extent.height / (2.0f * tanf(glm_rad(p_app->view.fov_y) * 0.5f));
+
+	_cull_push_constants push_constants = {
+		.candidate_count = candidate_count,
+		.lod_count = p_app->mesh.impostor,
+		.pixel_scale = pixel_scale,
+		.hysteresis = p_app->config.lod.hysteresis,
+		.impostor_pixels = p_app->config.lod.impostor_pixels,
+	};
+	memcpy(push_constants.lod_pixels, p_app->cull.lod_pixels, sizeof(push_constants.lod_pixels));
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p_app->cull.pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+												 p_app->cull.layout, 0, 1,
+												 &p_app->cull.sets[p_app->sync.frame_index], 0, NULL);
+	vkCmdPushConstants(command_buffer, p_app->cull.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+
+	// the lod states are shared between slots, so the previous frame's cull
+	// has to have written them before this one reads them
+	VkMemoryBarrier state_barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+		command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &state_barrier,
+		0, NULL,
+		0, NULL
+	);
+
+	vkCmdDispatch(command_buffer, (candidate_count + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+		command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, NULL,
+		0, NULL
+	);
+}
+
+// issues the indirect commands [first, first + count). they are one multi
+// draw when the device allows it, otherwise one draw each where empty ones
+// are skipped on the gpu through the draw count with drawIndirectCount and
+// draw zero instances without
+void record_cull_draw_range(_app *p_app, VkCommandBuffer command_buffer, u32 first, u32 count) {
+	VkBuffer draws = p_app->cull.draws[p_app->sync.frame_index].buffer;
+	VkDeviceSize first_offset = offsetof(_cull_draws, commands) + first * sizeof(VkDrawIndexedIndirectCommand);
+
+	if (p_app->device.multi_draw_indirect) {
+		vkCmdDrawIndexedIndirect(command_buffer, draws, first_offset, count, sizeof(VkDrawIndexedIndirectCommand));
+		return;
+	}
+
+	for (u32 draw = first; draw < first + count; draw++) {
+		VkDeviceSize command_offset = offsetof(_cull_draws, commands) + draw * sizeof(VkDrawIndexedIndirectCommand);
+
+		if (p_app->device.draw_indirect_count) {
+			VkDeviceSize count_offset = offsetof(_cull_draws, draw_counts) + draw * sizeof(u32);
+			vkCmdDrawIndexedIndirectCount(command_buffer, draws, command_offset, draws, count_offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+		} else {
+			vkCmdDrawIndexedIndirect(command_buffer, draws, command_offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+}
+
+// every mesh lives in the shared mesh buffers, so the sphere lods and the
+// impostor quad share their mesh and material keys and the queue binds the
+// buffers once, only the pipeline changes between
+void queue_culled_draws(_app *p_app, _render_queue *queue) {
+	if (p_app->visibility.sphere_count == 0) return;
+
+	_draw_packet packet = {
+		.pipeline = p_app->pipeline.opaque,
+		.layout = p_app->pipeline.layout,
+		.material = p_app->descriptor.sets[p_app->sync.frame_index],
+		.vertex_buffer = p_app->mesh.vertex_buffer,
+		.index_buffer = p_app->mesh.index_buffer,
+		.index_type = p_app->mesh.index_type,
+		.indirect = true,
+		.first = 0,
+		.count = p_app->mesh.impostor,
+	};
+	push_render_queue(queue, RECORD_PASS_OPAQUE, 0.0f, &packet);
+
+	if (p_app->config.lod.impostor_pixels > 0.0f) {
+		packet.pipeline = p_app->pipeline.impostor;
+		packet.first = p_app->mesh.impostor;
+		packet.count = 1;
+		push_render_queue(queue, RECORD_PASS_OPAQUE, 0.0f, &packet);
+	}
+}
+
+void destroy_cull(_app *p_app) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		destroy_mapped_buffer(p_app, &p_app->cull.draws[i]);
+		destroy_mapped_buffer(p_app, &p_app->cull.instances[i]);
+	}
+	destroy_mapped_buffer(p_app, &p_app->cull.lod_states);
+	free(p_app->cull.draws);
+	free(p_app->cull.instances);
+	free(p_app->cull.bound_lod_states);
+
+	vkDestroyDescriptorPool(p_app->device.logical, p_app->cull.pool, NULL);
+	vkDestroyDescriptorSetLayout(p_app->device.logical, p_app->cull.descriptor_set_layout, NULL);
+	free(p_app->cull.sets);
+
+	vkDestroyPipeline(p_app->device.logical, p_app->cull.pipeline, NULL);
+	vkDestroyPipelineLayout(p_app->device.logical, p_app->cull.layout, NULL);
+
+	p_app->cull = (_app_cull){0};
+}
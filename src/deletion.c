@@ -0,0 +1,172 @@
+#include "headers/deletion.h"
+#include "headers/sync.h"
+
+// resources retired while recording frame n are owned by that frame slot,
+// they are only destroyed once the slot's timeline value has been waited on
+
+void create_deletion_queues(_app *p_app) {
+	p_app->deletion.entries = malloc(sizeof(_deletion_entry*) * p_app->sync.frames_in_flight);
+	p_app->deletion.counts = malloc(sizeof(u32) * p_app->sync.frames_in_flight);
+	p_app->deletion.capacities = malloc(sizeof(u32) * p_app->sync.frames_in_flight);
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		p_app->deletion.entries[i] = NULL;
+		p_app->deletion.counts[i] = 0;
+		p_app->deletion.capacities[i] = 0;
+	}
+
+	p_app->deletion.swapchains = NULL;
+	p_app->deletion.swapchain_count = 0;
+	p_app->deletion.swapchain_capacity = 0;
+}
+
+static void push_deletion_entry(_app *p_app, u32 frame_index, _deletion_entry entry) {
+	u32 count = p_app->deletion.counts[frame_index];
+	if (count >= p_app->deletion.capacities[frame_index]) {
+		u32 capacity = p_app->deletion.capacities[frame_index] ? p_app->deletion.capacities[frame_index] * 2 : 8;
+		p_app->deletion.entries[frame_index] = realloc(p_app->deletion.entries[frame_index], sizeof(_deletion_entry) * capacity);
+		p_app->deletion.capacities[frame_index] = capacity;
+	}
+
+	p_app->deletion.entries[frame_index][count] = entry;
+	p_app->deletion.counts[frame_index] = count + 1;
+}
+
+void defer_buffer_destruction(_app *p_app, u32 frame_index, VkBuffer buffer, VmaAllocation allocation) {
+	if (buffer == VK_NULL_HANDLE) return;
+
+	push_deletion_entry(p_app, frame_index, (_deletion_entry){
+		.type = DELETION_BUFFER,
+		.buffer = buffer,
+		.allocation = allocation,
+	});
+}
+
+void defer_image_destruction(_app *p_app, u32 frame_index, VkImage image, VkImageView image_view, VmaAllocation allocation) {
+	if (image == VK_NULL_HANDLE) return;
+
+	push_deletion_entry(p_app, frame_index, (_deletion_entry){
+		.type = DELETION_IMAGE,
+		.image = image,
+		.image_view = image_view,
+		.allocation = allocation,
+	});
+}
+
+void defer_framebuffer_destruction(_app *p_app, u32 frame_index, VkFramebuffer framebuffer) {
+	if (framebuffer == VK_NULL_HANDLE) return;
+
+	push_deletion_entry(p_app, frame_index, (_deletion_entry){
+		.type = DELETION_FRAMEBUFFER,
+		.framebuffer = framebuffer,
+	});
+}
+
+// takes ownership of the image_views array. the gpu being done with the
+// old images says nothing about the presentation engine, so the swapchain
+// isnt tied to a frame slot and instead outlives presents_left presents on
+// its successor, by then every image queued on it has been replaced
+void defer_swapchain_destruction(_app *p_app, VkSwapchainKHR swapchain, VkImageView *image_views, u32 count, u32 presents_left) {
+	if (p_app->deletion.swapchain_count >= p_app->deletion.swapchain_capacity) {
+		u32 capacity = p_app->deletion.swapchain_capacity ? p_app->deletion.swapchain_capacity * 2 : 4;
+		p_app->deletion.swapchains = realloc(p_app->deletion.swapchains, sizeof(_deletion_entry) * capacity);
+		p_app->deletion.swapchain_capacity = capacity;
+	}
+
+	p_app->deletion.swapchains[p_app->deletion.swapchain_count++] = (_deletion_entry){
+		.type = DELETION_SWAPCHAIN,
+		.swapchain = swapchain,
+		.image_views = image_views,
+		.count = count,
+		.timeline_value = p_app->sync.timeline_value,
+		.presents_left = presents_left,
+	};
+}
+
+static void destroy_retired_swapchain(_app *p_app, _deletion_entry *entry) {
+	for (u32 v = 0; v < entry->count; v++) {
+		vkDestroyImageView(p_app->device.logical, entry->image_views[v], NULL);
+	}
+	free(entry->image_views);
+	vkDestroySwapchainKHR(p_app->device.logical, entry->swapchain, NULL);
+}
+
+// called after every present on the current swapchain, a retired one goes
+// once its presents are counted out and its last frame is off the gpu
+void release_retired_swapchains(_app *p_app) {
+	if (p_app->deletion.swapchain_count == 0) return;
+
+	uint64_t completed = completed_timeline_value(p_app);
+	u32 kept = 0;
+	for (u32 i = 0; i < p_app->deletion.swapchain_count; i++) {
+		_deletion_entry entry = p_app->deletion.swapchains[i];
+		if (entry.presents_left > 0) entry.presents_left--;
+
+		if (entry.presents_left == 0 && completed >= entry.timeline_value) {
+			destroy_retired_swapchain(p_app, &entry);
+		} else {
+			p_app->deletion.swapchains[kept++] = entry;
+		}
+	}
+	p_app->deletion.swapchain_count = kept;
+}
+
+// takes ownership of the command_buffers array
+void defer_command_buffer_destruction(_app *p_app, u32 frame_index, VkCommandPool command_pool, VkCommandBuffer *command_buffers, u32 count) {
+	if (!command_buffers) return;
+
+	push_deletion_entry(p_app, frame_index, (_deletion_entry){
+		.type = DELETION_COMMAND_BUFFERS,
+		.command_pool = command_pool,
+		.command_buffers = command_buffers,
+		.count = count,
+	});
+}
+
+void flush_deletion_queue(_app *p_app, u32 frame_index) {
+	for (u32 i = 0; i < p_app->deletion.counts[frame_index]; i++) {
+		_deletion_entry *entry = &p_app->deletion.entries[frame_index][i];
+		switch (entry->type) {
+			case DELETION_BUFFER:
+				vmaDestroyBuffer(p_app->mem.alloc, entry->buffer, entry->allocation);
+				break;
+			case DELETION_IMAGE:
+				vkDestroyImageView(p_app->device.logical, entry->image_view, NULL);
+				vmaDestroyImage(p_app->mem.alloc, entry->image, entry->allocation);
+				break;
+			case DELETION_FRAMEBUFFER:
+				vkDestroyFramebuffer(p_app->device.logical, entry->framebuffer, NULL);
+				break;
+			case DELETION_SWAPCHAIN:
+				destroy_retired_swapchain(p_app, entry);
+				break;
+			case DELETION_COMMAND_BUFFERS:
+				vkFreeCommandBuffers(p_app->device.logical, entry->command_pool, entry->count, entry->command_buffers);
+				free(entry->command_buffers);
+				break;
+		}
+	}
+	p_app->deletion.counts[frame_index] = 0;
+}
+
+void destroy_deletion_queues(_app *p_app) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		flush_deletion_queue(p_app, i);
+		free(p_app->deletion.entries[i]);
+	}
+	free(p_app->deletion.entries);
+	p_app->deletion.entries = NULL;
+	free(p_app->deletion.counts);
+	p_app->deletion.counts = NULL;
+	free(p_app->deletion.capacities);
+	p_app->deletion.capacities = NULL;
+
+	// the device is idle by now, nothing is left queued on these
+	for (u32 i = 0; i < p_app->deletion.swapchain_count; i++) {
+		destroy_retired_swapchain(p_app, &p_app->deletion.swapchains[i]);
+	}
+	free(p_app->deletion.swapchains);
+	p_app->deletion.swapchains = NULL;
+	p_app->deletion.swapchain_count = 0;
+	p_app->deletion.swapchain_capacity = 0;
+}
@@ -26,10 +26,28 @@ void create_descriptor_set_layout(_app *p_app) {
 		.pImmutableSamplers = NULL,
 	};
 
+	VkDescriptorSetLayoutBinding sbo_instance_layout_binding = {
+		.binding = 3,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.pImmutableSamplers = NULL,
+	};
+
+	VkDescriptorSetLayoutBinding sbo_culled_instance_layout_binding = {
+		.binding = 4,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.pImmutableSamplers = NULL,
+	};
+
 	VkDescriptorSetLayoutBinding bindings[] = {
 		ubo_layout_binding,
 		sbo_billboard_layout_binding,
 		sbo_solar_object_layout_binding,
+		sbo_instance_layout_binding,
+		sbo_culled_instance_layout_binding,
 	};
 
 	VkDescriptorSetLayoutCreateInfo descriptor_layout_create_info = {
@@ -52,23 +70,31 @@ void create_descriptor_pool(_app *p_app) {
 	VkDescriptorPoolSize pool_sizes[] = {
 		{
 			.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			.descriptorCount = MAX_FRAMES_IN_FLIGHT
+			.descriptorCount = p_app->sync.frames_in_flight
 		},
 		{
 			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-			.descriptorCount = MAX_FRAMES_IN_FLIGHT
+			.descriptorCount = p_app->sync.frames_in_flight
 		},
 		{
 			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-			.descriptorCount = MAX_FRAMES_IN_FLIGHT
+			.descriptorCount = p_app->sync.frames_in_flight
+		},
+		{
+			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = p_app->sync.frames_in_flight
+		},
+		{
+			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = p_app->sync.frames_in_flight
 		}
 	};
 
 	VkDescriptorPoolCreateInfo pool_create_info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.poolSizeCount = 3,
+		.poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]),
 		.pPoolSizes = pool_sizes,
-		.maxSets = MAX_FRAMES_IN_FLIGHT,
+		.maxSets = p_app->sync.frames_in_flight,
 	};
 
 	if (vkCreateDescriptorPool(p_app->device.logical, &pool_create_info, NULL, &p_app->descriptor.pool) != VK_SUCCESS) {
@@ -82,17 +108,17 @@ void create_descriptor_pool(_app *p_app) {
 }
 
 void create_descriptor_sets(_app *p_app) {
-	p_app->descriptor.sets = malloc(sizeof(VkDescriptorSet) * MAX_FRAMES_IN_FLIGHT);
-	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * MAX_FRAMES_IN_FLIGHT);
+	p_app->descriptor.sets = malloc(sizeof(VkDescriptorSet) * p_app->sync.frames_in_flight);
+	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * p_app->sync.frames_in_flight);
 
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
 		layouts[i] = p_app->pipeline.descriptor_set_layout;
 	}
 
 	VkDescriptorSetAllocateInfo alloc_info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.descriptorPool = p_app->descriptor.pool,
-		.descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+		.descriptorSetCount = p_app->sync.frames_in_flight,
 		.pSetLayouts = layouts,
 	};
 
@@ -105,7 +131,7 @@ void create_descriptor_sets(_app *p_app) {
 		exit(EXIT_FAILURE);
 	}
 
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
 		VkDescriptorBufferInfo ubo_info = {
 			.buffer = p_app->uniform.buffers[i],
 			.offset = 0,
@@ -113,13 +139,19 @@ void create_descriptor_sets(_app *p_app) {
 		};
 
 		VkDescriptorBufferInfo sbo_billboard_info = {
-			.buffer = p_app->storage.billboard_buffers[i],
+			.buffer = p_app->storage.billboards[i].buffer,
 			.offset = 0,
 			.range = VK_WHOLE_SIZE,
 		};
 
 		VkDescriptorBufferInfo sbo_solar_object_info = {
-			.buffer = p_app->storage.solar_object_buffers[i],
+			.buffer = p_app->storage.solar_objects[i].buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkDescriptorBufferInfo sbo_instance_info = {
+			.buffer = p_app->storage.instances[i].buffer,
 			.offset = 0,
 			.range = VK_WHOLE_SIZE,
 		};
@@ -152,10 +184,39 @@ void create_descriptor_sets(_app *p_app) {
 				.descriptorCount = 1,
 				.pBufferInfo = &sbo_solar_object_info,
 			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = p_app->descriptor.sets[i],
+				.dstBinding = 3,
+				.dstArrayElement = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.pBufferInfo = &sbo_instance_info,
+			},
 		};
 
-		vkUpdateDescriptorSets(p_app->device.logical, 3, descriptor_writes, 0, NULL);
+		vkUpdateDescriptorSets(p_app->device.logical, 4, descriptor_writes, 0, NULL);
 	}
 
 	free(layouts);
 }
+
+void update_storage_descriptor(_app *p_app, VkDescriptorSet set, u32 binding, VkBuffer buffer) {
+	VkDescriptorBufferInfo sbo_info = {
+		.buffer = buffer,
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+
+	VkWriteDescriptorSet descriptor_write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = set,
+		.dstBinding = binding,
+		.dstArrayElement = 0,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.descriptorCount = 1,
+		.pBufferInfo = &sbo_info,
+	};
+
+	vkUpdateDescriptorSets(p_app->device.logical, 1, &descriptor_write, 0, NULL);
+}
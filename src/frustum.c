@@ -0,0 +1,173 @@
+#include "headers/frustum.h"
+#include "headers/workers.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+void create_frustum(_app *p_app) {
+	p_app->frustum = (_app_frustum){0};
+}
+
+// gribb hartmann, the planes are rows of proj * view summed and
+// differenced, normalised so a plane distance compares against a radius
+void update_frustum(_app *p_app, mat4 view, mat4 proj) {
+	mat4 view_proj;
+	glm_mat4_mul(proj, view, view_proj);
+
+	for (u32 p = 0; p < 6; p++) {
+		u32 row = p / 2;
+		float sign = (p & 1) ? -1.0f : 1.0f;
+		vec4 plane;
+		for (u32 c = 0; c < 4; c++) {
+			plane[c] = view_proj[c][3] + sign * view_proj[c][row];
+		}
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f) {
+			for (u32 c = 0; c < 4; c++) plane[c] /= length;
+		}
+		glm_vec4_copy(plane, p_app->frustum.planes[p]);
+	}
+}
+
+// grows the packed centre and radius arrays to hold count spheres rounded up
+// to a whole block of lanes, the padding lanes get a radius no plane can
+// pass so a block never needs a tail check
+void reserve_frustum(_app *p_app, u32 count) {
+	_app_frustum *frustum = &p_app->frustum;
+	u32 padded = (count + FRUSTUM_LANES - 1) & ~(FRUSTUM_LANES - 1);
+
+	if (padded > frustum->capacity) {
+		u32 capacity = padded * 2;
+		free(frustum->x);
+		free(frustum->y);
+		free(frustum->z);
+		free(frustum->r);
+		free(frustum->visible);
+		frustum->x = aligned_alloc(32, sizeof(float) * capacity);
+		frustum->y = aligned_alloc(32, sizeof(float) * capacity);
+		frustum->z = aligned_alloc(32, sizeof(float) * capacity);
+		frustum->r = aligned_alloc(32, sizeof(float) * capacity);
+		frustum->visible = malloc(sizeof(u32) * capacity);
+		frustum->capacity = capacity;
+	}
+
+	for (u32 i = count; i < padded; i++) {
+		frustum->x[i] = 0.0f;
+		frustum->y[i] = 0.0f;
+		frustum->z[i] = 0.0f;
+		frustum->r[i] = -FLT_MAX;
+	}
+}
+
+// tests [begin, end) eight spheres at a time and writes the indices that
+// survive every plane from visible + begin, returning how many did
+static u32 cull_frustum_range(const _app_frustum *frustum, u32 begin, u32 end) {
+	u32 *out = frustum->visible + begin;
+	u32 count = 0;
+
+#if defined(__AVX__)
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (u32 p = 0; p < 6; p++) {
+		px[p] = _mm256_set1_ps(frustum->planes[p][0]);
+		py[p] = _mm256_set1_ps(frustum->planes[p][1]);
+		pz[p] = _mm256_set1_ps(frustum->planes[p][2]);
+		pw[p] = _mm256_set1_ps(frustum->planes[p][3]);
+	}
+
+	for (u32 i = begin; i < end; i += FRUSTUM_LANES) {
+		__m256 x = _mm256_load_ps(frustum->x + i);
+		__m256 y = _mm256_load_ps(frustum->y + i);
+		__m256 z = _mm256_load_ps(frustum->z + i);
+		__m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_load_ps(frustum->r + i));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (u32 p = 0; p < 6; p++) {
+			__m256 d = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(x, px[p]), _mm256_mul_ps(y, py[p])),
+				_mm256_add_ps(_mm256_mul_ps(z, pz[p]), pw[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+		}
+
+		u32 mask = (u32)_mm256_movemask_ps(inside);
+		while (mask) {
+			out[count++] = i + (u32)__builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+#else
+	// without avx the block is written so the compiler can vectorise the
+	// lane loop with whatever width the target has
+	for (u32 i = begin; i < end; i += FRUSTUM_LANES) {
+		u32 mask = 0;
+		for (u32 lane = 0; lane < FRUSTUM_LANES; lane++) {
+			float x = frustum->x[i + lane];
+			float y = frustum->y[i + lane];
+			float z = frustum->z[i + lane];
+			float neg_r = -frustum->r[i + lane];
+			bool inside = true;
+			for (u32 p = 0; p < 6; p++) {
+				const float *plane = frustum->planes[p];
+				inside &= plane[0] * x + plane[1] * y + plane[2] * z + plane[3] >= neg_r;
+			}
+			mask |= (u32)inside << lane;
+		}
+
+		while (mask) {
+			out[count++] = i + (u32)__builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	return count;
+}
+
+static void cull_frustum_job(_app *p_app, u32 task) {
+	_frustum_job *job = &p_app->frustum.jobs[task];
+	job->count = cull_frustum_range(&p_app->frustum, job->begin, job->end);
+}
+
+// returns the number of visible spheres, their indices sit ascending in
+// frustum.visible. large counts are split into block aligned chunks across
+// the workers, each compacts into its own slice and the slices are closed up
+u32 cull_frustum(_app *p_app, u32 count) {
+	_app_frustum *frustum = &p_app->frustum;
+	u32 padded = (count + FRUSTUM_LANES - 1) & ~(FRUSTUM_LANES - 1);
+	if (padded == 0) return 0;
+
+	u32 thread_count = p_app->workers.count + 1;
+	if (count < FRUSTUM_THREAD_THRESHOLD || thread_count < 2) {
+		return cull_frustum_range(frustum, 0, padded);
+	}
+
+	u32 chunk = (padded / thread_count + FRUSTUM_LANES - 1) & ~(FRUSTUM_LANES - 1);
+
+	for (u32 t = 0; t < thread_count; t++) {
+		u32 begin = t * chunk;
+		u32 end = begin + chunk;
+		if (begin > padded) begin = padded;
+		if (end > padded || t == thread_count - 1) end = padded;
+		frustum->jobs[t] = (_frustum_job){ .begin = begin, .end = end, .count = 0 };
+	}
+
+	run_worker_tasks(p_app, cull_frustum_job, thread_count, true);
+
+	u32 visible = frustum->jobs[0].count;
+	for (u32 t = 1; t < thread_count; t++) {
+		if (frustum->jobs[t].count > 0) {
+			memmove(frustum->visible + visible, frustum->visible + frustum->jobs[t].begin, sizeof(u32) * frustum->jobs[t].count);
+		}
+		visible += frustum->jobs[t].count;
+	}
+
+	return visible;
+}
+
+void destroy_frustum(_app *p_app) {
+	free(p_app->frustum.x);
+	free(p_app->frustum.y);
+	free(p_app->frustum.z);
+	free(p_app->frustum.r);
+	free(p_app->frustum.visible);
+	p_app->frustum = (_app_frustum){0};
+}
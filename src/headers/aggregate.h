@@ -0,0 +1,10 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "define.h"
+
+void create_aggregates(_app *p_app);
+void update_aggregates(_app *p_app);
+void destroy_aggregates(_app *p_app);
+
+#endif
@@ -9,13 +9,13 @@ void create_billboard_buffer(_app *p_app);
 void create_mesh_buffer(_app *p_app);
 void create_grid_buffer(_app *p_app);
 void create_uniform_buffers(_app *p_app);
+void create_mapped_buffer(_app *p_app, VkDeviceSize size, VkBufferUsageFlags usage, _mapped_buffer *p_buffer);
+bool grow_mapped_buffer(_app *p_app, u32 frame_index, _mapped_buffer *p_buffer, VkDeviceSize required_size, VkBufferUsageFlags usage);
+void destroy_mapped_buffer(_app *p_app, _mapped_buffer *p_buffer);
 void create_storage_buffers(_app *p_app);
-void recreate_billboard_storage_buffers(_app *p_app, VkDeviceSize new_size);
-void recreate_solar_object_storage_buffers(_app *p_app, VkDeviceSize new_size);
 
 void create_command_pool(_app *p_app);
 void create_command_buffers(_app *p_app);
-int compare_render_order(const void* a, const void* b);
 void record_command_buffer(_app *p_app, VkCommandBuffer command_buffer, uint32_t image_index);
 VkCommandBuffer begin_single_time_commands(_app *p_app);
 void end_single_time_commands(_app *p_app, VkCommandBuffer command_buffer);
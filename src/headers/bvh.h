@@ -0,0 +1,14 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "define.h"
+
+void create_bvh(_app *p_app);
+void build_bvh(_app *p_app);
+void refit_bvh(_app *p_app);
+void update_bvh(_app *p_app);
+void destroy_bvh(_app *p_app);
+u32 bvh_ray_cast(_app *p_app, vec3 origin, vec3 direction, float *out_t);
+u32 bvh_query_radius(_app *p_app, vec3 centre, float radius, u32 *out_indices, u32 max_indices);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef CULL_H
+#define CULL_H
+
+#include "define.h"
+
+#define CULL_WORKGROUP_SIZE 64
+
+void create_cull_descriptor_set_layout(_app *p_app);
+void create_cull_pipeline(_app *p_app);
+void create_cull_buffers(_app *p_app);
+void create_cull_descriptor_pool(_app *p_app);
+void create_cull_descriptor_sets(_app *p_app);
+void update_cull_buffers(_app *p_app, u32 frame_index);
+void record_cull(_app *p_app, VkCommandBuffer command_buffer);
+void record_cull_draw_range(_app *p_app, VkCommandBuffer command_buffer, u32 first, u32 count);
+void queue_culled_draws(_app *p_app, _render_queue *queue);
+void destroy_cull(_app *p_app);
+
+#endif
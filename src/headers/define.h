@@ -10,6 +10,8 @@
 #include <assert.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -45,15 +47,22 @@ typedef int32_t i32;
 #define MASS_SCALE 1.0f / 1.989e30f
 #define RADIUS_SCALE 1.0f / 6.957e8f     
 #define SBO_HEADER_SIZE (sizeof(u32) * 4)
+#define MESH_SPHERE_LOD_MAX 8
 #define COLOUR_NOT_SET 0xFFFFFFFF
 
-extern const u32 MAX_FRAMES_IN_FLIGHT;
+// upper bound on config.sync.frames_in_flight, the count itself is picked
+// at startup and lives in sync.frames_in_flight
+#define MAX_FRAMES_IN_FLIGHT 4
+
+// the calling thread plus the persistent workers
+#define WORKER_MAX_THREADS 8
 
 u32 clamp(u32 n, u32 min, u32 max);
 
 typedef enum _config_flags {
 	CONFIG_FLAG_NONE = 0,
 	CONFIG_FLAG_PRINT_FPS = 1 << 0,
+	CONFIG_FLAG_BENCHMARK_SORT = 1 << 1,
 } _config_flags;
 
 typedef enum _billboard_type_flags {
@@ -72,22 +81,6 @@ typedef enum _billboard_location_flags {
 	BILLBOARD_LOCATION_IN_HUD = 1 << 0,
 } _billboard_location_flags;
 
-typedef enum _mesh_sphere_lod {
-	MESH_SPHERE_LOD0,
-	MESH_SPHERE_LOD1,
-	MESH_SPHERE_LOD2,
-	MESH_SPHERE_LOD3,
-	MESH_SPHERE_LOD_COUNT,
-} _mesh_sphere_lod;
-
-typedef enum _mesh_shape_type {
-	MESH_SHAPE_SPHERE_LOD0,
-	MESH_SHAPE_SPHERE_LOD1,
-	MESH_SHAPE_SPHERE_LOD2,
-	MESH_SHAPE_SPHERE_LOD3,
-	MESH_SHAPE_COUNT,
-} _mesh_shape_type;
-
 typedef enum _solar_object_type {
 	SOLAR_OBJECT_TYPE_PLAIN,
 	SOLAR_OBJECT_TYPE_LIGHT_EMIT,
@@ -106,16 +99,19 @@ typedef enum _planet_type {
     PLANET_TYPE_COUNT,
 } _planet_type;
 
-typedef struct _billboard_legacy {
-	vec4 pos;
-	vec4 data;
-	u32 udata[4];
-	u32 flags[4];
-} _billboard_legacy;
+typedef enum _record_pass {
+	RECORD_PASS_OPAQUE,
+	RECORD_PASS_TRANSPARENT,
+	RECORD_PASS_COUNT,
+} _record_pass;
 
-typedef struct _push_constants {
-	u32 object_index;
-} _push_constants;
+typedef enum _static_pass {
+	STATIC_PASS_GRID,
+	STATIC_PASS_COMPOSITE,
+	STATIC_PASS_LENS,
+	STATIC_PASS_PRESENT,
+	STATIC_PASS_COUNT,
+} _static_pass;
 
 typedef struct _billboard {
 	union {
@@ -170,18 +166,27 @@ typedef struct _billboard {
 	union {
 		u32 flags[4];
 		struct {
-			u32 type, shape, location, reserved;
+			u32 type, shape, location, object_index;
 		};
 	};
 } _billboard;
 
+// 16 bytes, packed by pack_vertex: snorm16 position in the unit cube,
+// half uv and an octahedral snorm16 normal
 typedef struct _vertex {
-	float pos[3];
-	float uv[2];
-	float norm[3];
-	u32 data[4];
+	i16 pos[4];
+	u16 uv[2];
+	i16 norm[2];
 } _vertex;
 
+// where one mesh sits in the shared vertex and index buffers
+typedef struct _mesh_range {
+	u32 first_index;
+	u32 index_count;
+	i32 vertex_offset;
+	u32 vertex_count;
+} _mesh_range;
+
 typedef struct _grid_vertex {
 	float pos[3];
 } _grid_vertex;
@@ -229,6 +234,8 @@ typedef struct _candidates {
 	u32 score;
 } _candidates;
 
+// the four camera matrices lead the ubo, draw_frame rewrites just that
+// region of the mapped buffer right before submit
 typedef struct _ubo {
 	mat4 proj;
 	mat4 view;
@@ -238,21 +245,85 @@ typedef struct _ubo {
 	vec4 grid_params;
 } _ubo;
 
-typedef struct _sbo {
-	u32 billboard_count;
-	_billboard *billboards;
-} _sbo;
-
-typedef struct _render_order {
-	u32 object_index;
-	float distance;
-} _render_order;
+#define UBO_CAMERA_SIZE offsetof(_ubo, ambient)
+
+// the newest input event a frame latched and the timeline value of that
+// frame, pending until the frame is seen complete
+typedef struct _latched_input {
+	struct timespec input_time;
+	uint64_t value;
+	bool pending;
+} _latched_input;
+
+typedef struct _cull_draws {
+	VkDrawIndexedIndirectCommand commands[MESH_SPHERE_LOD_MAX + 1];
+	u32 draw_counts[MESH_SPHERE_LOD_MAX + 1];
+} _cull_draws;
+
+typedef struct _cull_push_constants {
+	u32 candidate_count;
+	u32 lod_count;
+	float pixel_scale;
+	float hysteresis;
+	float impostor_pixels;
+	float lod_pixels[MESH_SPHERE_LOD_MAX - 1];
+} _cull_push_constants;
+
+typedef struct _mapped_buffer {
+	VkBuffer buffer;
+	VmaAllocation allocation;
+	void* mapped;
+	VkDeviceSize size;
+} _mapped_buffer;
+
+typedef struct _bvh_node {
+	vec3 min;
+	u32 left_first;
+	vec3 max;
+	u32 count;
+} _bvh_node;
+
+typedef struct _aggregate_node {
+	vec3 weighted_position;
+	float weight;
+	vec3 weighted_colour;
+	float luminosity;
+} _aggregate_node;
+
+typedef enum _deletion_type {
+	DELETION_BUFFER,
+	DELETION_IMAGE,
+	DELETION_FRAMEBUFFER,
+	DELETION_SWAPCHAIN,
+	DELETION_COMMAND_BUFFERS,
+} _deletion_type;
+
+// only the fields of the entry's type are set, an image's view and a
+// swapchain's image views go with it. a swapchain also carries the last
+// timeline value to render into it and the presents it still waits out
+typedef struct _deletion_entry {
+	_deletion_type type;
+	VkBuffer buffer;
+	VkImage image;
+	VkImageView image_view;
+	VmaAllocation allocation;
+	VkFramebuffer framebuffer;
+	VkSwapchainKHR swapchain;
+	VkImageView *image_views;
+	uint64_t timeline_value;
+	u32 presents_left;
+	VkCommandPool command_pool;
+	VkCommandBuffer *command_buffers;
+	u32 count;
+} _deletion_entry;
 
 typedef struct _queue_family_indices {
 	u32 graphics_family;
 	u32 present_family;
+	u32 transfer_family;
 	u32 is_graphics_family_set;
 	u32 is_present_family_set;
+	u32 is_transfer_family_set;
 } _queue_family_indices;
 
 typedef struct _swapchain_support {
@@ -277,8 +348,11 @@ typedef struct _app_device {
 	VkDevice logical;
 	VkQueue graphics_queue;
 	VkQueue present_queue;
+	VkQueue transfer_queue;
 	_queue_family_indices queue_indices;
 	VkSampleCountFlagBits msaa_samples;
+	bool draw_indirect_count;
+	bool multi_draw_indirect;
 } _app_device;
 
 typedef struct _app_swapchain {
@@ -291,19 +365,95 @@ typedef struct _app_swapchain {
 	VkExtent2D extent;
 	VkExtent2D render_extent;
 	bool framebuffer_resized;
+	// a bit per frame slot whose descriptor sets still name the render
+	// targets from before a resize, rewritten once that slot is idle
+	u32 stale_target_slots;
 } _app_swapchain;
 
+// independent pipelines are compiled together, each worker takes every
+// stride-th job from first
+typedef struct _pipeline_job {
+	const char *name;
+	const VkGraphicsPipelineCreateInfo *info;
+	VkPipeline *p_pipeline;
+	VkResult result;
+} _pipeline_job;
+
+typedef struct _pipeline_worker {
+	struct _app *p_app;
+	_pipeline_job *jobs;
+	u32 count;
+	u32 first;
+	u32 stride;
+} _pipeline_worker;
+
 typedef struct _app_pipeline {
 	VkRenderPass render_pass;
 	VkDescriptorSetLayout descriptor_set_layout;
 	VkPipelineLayout layout;
 	VkPipeline opaque;
+	VkPipeline impostor;
 	VkPipeline transparent;
-	VkPipeline billboard;
 	VkPipeline grid;
+	VkPipeline point;
 	VkFramebuffer* swapchain_framebuffers;
+	// every pipeline is created through one cache, loaded from and saved
+	// back to a file named for the device it was built on
+	VkPipelineCache cache;
+	char cache_path[256];
+	bool cache_warm;
 } _app_pipeline;
 
+typedef struct _app_cull {
+	VkDescriptorSetLayout descriptor_set_layout;
+	VkPipelineLayout layout;
+	VkPipeline pipeline;
+	VkDescriptorPool pool;
+	VkDescriptorSet *sets;
+	_mapped_buffer *draws;
+	_mapped_buffer *instances;
+	_mapped_buffer lod_states;
+	VkBuffer *bound_lod_states;
+	float lod_pixels[MESH_SPHERE_LOD_MAX - 1];
+} _app_cull;
+
+typedef struct _app_oit {
+	struct {
+		VkImage image;
+		VmaAllocation image_allocation;
+		VkImageView image_view;
+	} accum;
+	struct {
+		VkImage image;
+		VmaAllocation image_allocation;
+		VkImageView image_view;
+	} revealage;
+	struct {
+		VkDescriptorSetLayout descriptor_set_layout;
+		VkPipelineLayout layout;
+		VkPipeline pipeline;
+	} composite;
+	struct {
+		VkDescriptorPool pool;
+		VkDescriptorSet *sets;
+	} descriptor;
+} _app_oit;
+
+// lens quality is chosen through specialisation constants of lens.frag,
+// the values of each level are in lens.c
+typedef enum _lens_quality {
+	LENS_QUALITY_LOW,
+	LENS_QUALITY_MEDIUM,
+	LENS_QUALITY_HIGH,
+	LENS_QUALITY_COUNT,
+} _lens_quality;
+
+typedef struct _lens_specialization {
+	i32 max_rk4_steps;
+	float influence_factor;
+	float dphi_base;
+} _lens_specialization;
+
 typedef struct _app_lens {
 	struct {
 		VkRenderPass render_pass;
@@ -312,6 +462,16 @@ typedef struct _app_lens {
 		VkPipelineLayout layout;
 		VkPipeline pipeline;
 	} pass;
+	// the baseline variant is built at startup, the rest on a background
+	// thread that sets a ready bit per quality as each one lands
+	struct {
+		VkPipeline pipelines[LENS_QUALITY_COUNT];
+		atomic_uint ready;
+		_lens_quality active;
+		_lens_quality requested;
+		pthread_t thread;
+		bool thread_started;
+	} variant;
 	struct {
 		VkDescriptorPool pool;
 		VkDescriptorSet *sets;
@@ -324,15 +484,115 @@ typedef struct _app_lens {
 	} target;
 } _app_lens;
 
+// one draw as submitted to a render queue, the sort key is built from the
+// pass, the interned pipeline, vertex buffer and descriptor set and the
+// depth so sorting groups packets that share state
+typedef struct _draw_packet {
+	uint64_t key;
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	VkDescriptorSet material;
+	VkBuffer vertex_buffer;
+	VkBuffer index_buffer;
+	VkIndexType index_type;
+	bool indirect;
+	u32 first;
+	u32 count;
+	u32 first_instance;
+	u32 instance_count;
+} _draw_packet;
+
+typedef struct _draw_sort {
+	uint64_t key;
+	u32 index;
+} _draw_sort;
+
+typedef struct _render_queue_stats {
+	u32 pipeline_binds;
+	u32 vertex_binds;
+	u32 index_binds;
+	u32 descriptor_binds;
+	u32 draws;
+} _render_queue_stats;
+
+typedef struct _render_queue {
+	_draw_packet *packets;
+	_draw_sort *order;
+	_draw_sort *scratch;
+	// last frame's sorted packet order, reused when the count matches
+	u32 *previous;
+	u32 previous_count;
+	u32 count;
+	u32 capacity;
+	// handles seen this frame per key field, their index is the field value
+	uint64_t *states;
+	u32 state_counts[3];
+	_render_queue_stats stats;
+} _render_queue;
+
+typedef void (*_worker_task)(struct _app *p_app, u32 task);
+
+// threads started once at init and parked on wake between runs, shared by
+// the frustum cull and recording. a run hands out tasks [0, task_count)
+// through next_task to the workers and the calling thread alike, running
+// counts workers not yet back from it
+typedef struct _app_workers {
+	pthread_t threads[WORKER_MAX_THREADS - 1];
+	u32 count;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	uint64_t generation;
+	u32 running;
+	bool quit;
+	_worker_task task;
+	u32 task_count;
+	atomic_uint next_task;
+} _app_workers;
+
+// the visible billboard indices are compacted in chunks, each chunk into
+// its own stretch of scratch, then copied to the ring at its prefix offset
+typedef struct _record_fill {
+	u32 *scratch;
+	u32 capacity;
+	u32 *out;
+	u32 chunk_count;
+	u32 firsts[WORKER_MAX_THREADS + 1];
+	u32 counts[WORKER_MAX_THREADS];
+	u32 offsets[WORKER_MAX_THREADS];
+	u32 draw_count;
+} _record_fill;
+
 typedef struct _app_commands {
 	VkCommandPool pool;
 	VkCommandBuffer* buffers;
+	// one pool and secondary per frame slot and pass, indexed
+	// frame * RECORD_PASS_COUNT + pass, so no two workers share a pool
+	VkCommandPool* worker_pools;
+	VkCommandBuffer* secondaries;
+	_record_fill fill;
+	u32 image_index;
+	// one queue per dynamic pass, each only touched by the worker recording it
+	_render_queue queues[RECORD_PASS_COUNT];
+	// passes that only change with the swapchain, indexed
+	// (image * frames_in_flight + frame) * STATIC_PASS_COUNT + pass
+	VkCommandPool static_pool;
+	VkCommandBuffer* statics;
+	bool* static_valid;
+	u32 static_slots;
 } _app_commands;
 
 typedef struct _app_sync {
 	VkSemaphore* image_available_semaphores;
 	VkSemaphore* render_finished_semaphores;
-	VkFence* in_flight_fences;
+	u32 render_finished_count;
+	// one timeline counts submitted frames, frame_values holds the value each
+	// frame slot's last submission signals so waiting on a slot is exact. a
+	// swapchain recreation raises its slot to the newest submission
+	VkSemaphore timeline;
+	uint64_t timeline_value;
+	uint64_t* frame_values;
+	u32 frames_in_flight;
 	u32 frame_index;
 } _app_sync;
 
@@ -343,19 +603,18 @@ typedef struct _app_memory {
 typedef struct _app_mesh {
 	_vertex** vertices; 
   u32** indices;
-	VkBuffer* vertex_buffers;
-	VkBuffer* index_buffers;
-	VmaAllocation* vertex_allocations;
-	VmaAllocation* index_allocations;
-	u32* vertex_counts;
-	u32* index_counts;
+	_mesh_range* ranges;
+	VkBuffer vertex_buffer;
+	VkBuffer index_buffer;
+	VmaAllocation vertex_allocation;
+	VmaAllocation index_allocation;
+	VkIndexType index_type;
+	u32 count;
+	u32 impostor;
 } _app_mesh;
 
 typedef struct _app_billboard {
-	VkBuffer instance_buffer;
-	VmaAllocation instance_allocation;
-	void* buffers_mapped;
-	size_t current_buffer_size;
+	_mapped_buffer *instances;
 } _app_billboard;
 
 typedef struct _app_grid {
@@ -372,17 +631,100 @@ typedef struct _app_uniforms {
 } _app_uniforms;
 
 typedef struct _app_storages {
-	VkBuffer* billboard_buffers;
-	VmaAllocation* billboard_buffer_allocations;
-	void** billboard_buffers_mapped;
-	size_t billboard_current_buffer_size;
-	
-	VkBuffer* solar_object_buffers;
-	VmaAllocation* solar_object_buffer_allocations;
-	void** solar_object_buffers_mapped;
-	size_t solar_object_current_buffer_size;
+	_mapped_buffer* billboards;
+	_mapped_buffer* solar_objects;
+	_mapped_buffer* instances;
 } _app_storages;
 
+typedef struct _upload_batch {
+	VkCommandBuffer command_buffer;
+	// timeline value signalled once the batch's copies are done, 0 before
+	// its first submit, and the ring position freed with it
+	uint64_t value;
+	uint64_t ring_end;
+	u32 copy_count;
+	// one off staging for spans bigger than the ring, freed with the batch
+	_mapped_buffer *spills;
+	u32 spill_count;
+	u32 spill_capacity;
+} _upload_batch;
+
+typedef struct _app_upload {
+	VkCommandPool pool;
+	VkSemaphore timeline;
+	uint64_t submitted;
+	uint64_t completed;
+	uint64_t graphics_waited;
+	// head and tail only grow, their difference is the ring space in use
+	_mapped_buffer ring;
+	uint64_t head;
+	uint64_t tail;
+	_upload_batch *batches;
+	u32 batch_index;
+	bool recording;
+	uint64_t bytes;
+	u32 copies;
+} _app_upload;
+
+typedef struct _app_deletion {
+	_deletion_entry** entries;
+	u32* counts;
+	u32* capacities;
+	_deletion_entry* swapchains;
+	u32 swapchain_count;
+	u32 swapchain_capacity;
+} _app_deletion;
+
+typedef struct _app_bvh {
+	_bvh_node *nodes;
+	u32 *indices;
+	u32 node_count;
+	u32 object_count;
+	float build_cost;
+} _app_bvh;
+
+typedef struct _app_aggregate {
+	_aggregate_node *nodes;
+	u32 *frontier;
+	u32 node_max;
+	u32 *resolved;
+	u32 resolved_count;
+	_billboard *impostors;
+	u32 impostor_count;
+	u32 object_max;
+} _app_aggregate;
+
+typedef struct _app_visibility {
+	u32 *bodies;
+	u32 body_count;
+	u32 *spheres;
+	u32 sphere_count;
+	u32 *points;
+	u32 point_count;
+	u32 *instances;
+	u32 instance_count;
+	u32 point_first;
+	u32 capacity;
+} _app_visibility;
+
+// one block aligned chunk of the cull, compacted into visible + begin
+typedef struct _frustum_job {
+	u32 begin;
+	u32 end;
+	u32 count;
+} _frustum_job;
+
+typedef struct _app_frustum {
+	vec4 planes[6];
+	float *x;
+	float *y;
+	float *z;
+	float *r;
+	u32 *visible;
+	u32 capacity;
+	_frustum_job jobs[WORKER_MAX_THREADS];
+} _app_frustum;
+
 typedef struct _app_descriptors {
 	VkDescriptorPool pool;
 	VkDescriptorSet* sets;
@@ -406,15 +748,27 @@ typedef struct _app_resolve {
 	VkImageView image_view;
 } _app_resolve;
 
+// a spir-v module linked into the binary, size is in bytes
+typedef struct _shader_code {
+	const u32 *code;
+	size_t size;
+} _shader_code;
+
 typedef struct _app_shader {
-	char *mesh_vert;
-	char *mesh_frag;
-	char *billboard_vert;
-	char *billboard_frag;
-	char *grid_vert;
-	char *grid_frag;
-	char *lens_vert;
-	char *lens_frag;
+	_shader_code mesh_vert;
+	_shader_code mesh_frag;
+	_shader_code billboard_vert;
+	_shader_code billboard_frag;
+	_shader_code grid_vert;
+	_shader_code grid_frag;
+	_shader_code lens_vert;
+	_shader_code lens_frag;
+	_shader_code composite_frag;
+	_shader_code point_vert;
+	_shader_code point_frag;
+	_shader_code cull_comp;
+	_shader_code impostor_vert;
+	_shader_code impostor_frag;
 } _app_shader;
 
 typedef struct _app_config {
@@ -426,11 +780,31 @@ typedef struct _app_config {
 		float render_extent_modifier;
 	} win;
 	struct {
-		u32 MESH_SPHERE_LOD_SEGMENTS[MESH_SPHERE_LOD_COUNT];
-		u32 MESH_SPHERE_LOD_RINGS[MESH_SPHERE_LOD_COUNT];
-		float MESH_SPHERE_LOD_DISTANCES[MESH_SPHERE_LOD_COUNT - 1];
+		u32 frames_in_flight;
+	} sync;
+	struct {
+		const char *directory;
+	} cache;
+	struct {
+		_lens_quality quality;
+	} lens;
+	struct {
+		u32 count;
+		u32 MESH_SPHERE_LOD_SEGMENTS[MESH_SPHERE_LOD_MAX];
+		u32 MESH_SPHERE_LOD_RINGS[MESH_SPHERE_LOD_MAX];
 		float MESH_SPHERE_LOD_RADIUS_MODIFIER;
+		float error_pixels;
+		float hysteresis;
+		float impostor_pixels;
 	} lod;
+	struct {
+		float cluster_pixels;
+		u32 max_primitives;
+		float reflected_intensity;
+	} aggregate;
+	struct {
+		float point_pixels;
+	} visibility;
 	struct {
 		float range;
 		float spacing;
@@ -446,6 +820,7 @@ typedef struct _app_objects {
 	_billboard *billboards;
 	u32 billboard_count;
 	u32 billboard_max;
+	u32 billboard_dirty_frames;
 	u32 primitive_count;
 } _app_objects;
 
@@ -470,6 +845,8 @@ typedef struct _app_view {
 	bool first_mouse;
 	bool mouse_locked;
 	float yaw, pitch;
+	u32 focus_index;
+	float focus_distance_multiplier;
 } _app_view;
 
 typedef struct _app_performance {
@@ -478,6 +855,18 @@ typedef struct _app_performance {
 	float frame_time_avg;
 	float fps_avg;
 	int frame_count;
+	uint64_t triangle_count;
+	_render_queue_stats binds;
+	struct timespec start_time;
+	bool first_frame_presented;
+	double pipeline_ms;
+	// input to gpu done runs from glfw delivering an event to the timeline
+	// value of the frame that latched it completing. present and scanout
+	// come after that and are not included
+	struct timespec input_time;
+	bool input_pending;
+	_latched_input latched[MAX_FRAMES_IN_FLIGHT];
+	double input_to_gpu_ms;
 } _app_performance;
 
 typedef struct _app {
@@ -487,19 +876,28 @@ typedef struct _app {
 	_app_swapchain swp;
 	_app_pipeline pipeline;
 	_app_commands cmd;
+	_app_workers workers;
 	_app_sync sync;
 	_app_memory mem;
 	_app_uniforms uniform;
 	_app_storages storage;
+	_app_deletion deletion;
+	_app_upload upload;
 	_app_descriptors descriptor;
 	_app_depth depth;
 	_app_colour colour;
 	_app_resolve resolve;
+	_app_oit oit;
 	_app_config config;
 	_app_mesh mesh;
 	_app_billboard billboard;
 	_app_grid grid;
 	_app_objects obj;
+	_app_bvh bvh;
+	_app_aggregate aggregate;
+	_app_visibility visibility;
+	_app_frustum frustum;
+	_app_cull cull;
 	_app_shader shader;
 	_app_view view;
 	_app_performance perf;
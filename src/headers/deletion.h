@@ -0,0 +1,16 @@
+#ifndef DELETION_H
+#define DELETION_H
+
+#include "define.h"
+
+void create_deletion_queues(_app *p_app);
+void defer_buffer_destruction(_app *p_app, u32 frame_index, VkBuffer buffer, VmaAllocation allocation);
+void defer_image_destruction(_app *p_app, u32 frame_index, VkImage image, VkImageView image_view, VmaAllocation allocation);
+void defer_framebuffer_destruction(_app *p_app, u32 frame_index, VkFramebuffer framebuffer);
+void defer_swapchain_destruction(_app *p_app, VkSwapchainKHR swapchain, VkImageView *image_views, u32 count, u32 presents_left);
+void release_retired_swapchains(_app *p_app);
+void defer_command_buffer_destruction(_app *p_app, u32 frame_index, VkCommandPool command_pool, VkCommandBuffer *command_buffers, u32 count);
+void flush_deletion_queue(_app *p_app, u32 frame_index);
+void destroy_deletion_queues(_app *p_app);
+
+#endif
@@ -6,5 +6,6 @@
 void create_descriptor_set_layout(_app *p_app);
 void create_descriptor_pool(_app *p_app);
 void create_descriptor_sets(_app *p_app);
+void update_storage_descriptor(_app *p_app, VkDescriptorSet set, u32 binding, VkBuffer buffer);
 
 #endif
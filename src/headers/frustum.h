@@ -0,0 +1,15 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "define.h"
+
+#define FRUSTUM_LANES 8
+#define FRUSTUM_THREAD_THRESHOLD (1u << 16)
+
+void create_frustum(_app *p_app);
+void update_frustum(_app *p_app, mat4 view, mat4 proj);
+void reserve_frustum(_app *p_app, u32 count);
+u32 cull_frustum(_app *p_app, u32 count);
+void destroy_frustum(_app *p_app);
+
+#endif
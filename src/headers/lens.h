@@ -3,6 +3,7 @@
 
 #include "define.h"
 
+#define LENS_QUALITY_BASELINE LENS_QUALITY_LOW
 
 void create_lens_render_pass(_app *p_app);
 void create_lens_image(_app *p_app);
@@ -10,10 +11,13 @@ void create_lens_framebuffer(_app *p_app);
 void create_lens_sampler(_app *p_app);
 void create_lens_descriptor_set_layout(_app *p_app);
 void create_lens_pipeline(_app *p_app);
+void select_lens_variant(_app *p_app);
+void cycle_lens_quality(_app *p_app);
+void destroy_lens_pipelines(_app *p_app);
 void create_lens_descriptor_pool(_app *p_app);
 void create_lens_descriptor_sets(_app *p_app);
 
-void cleanup_lens_swapchain(_app *p_app);
-void recreate_lens_swapchain(_app *p_app);
+void write_lens_descriptor_set(_app *p_app, u32 frame_index);
+void retire_lens_target(_app *p_app, u32 frame_index);
 
 #endif
@@ -9,6 +9,7 @@ float get_delta_time();
 void update_uniform_buffer(_app *p_app, u32 current_image);
 void update_storage_buffers(_app *p_app, u32 current_image);
 void update_billboards (_app *p_app);
+void update_focus(_app *p_app, float time);
 void update_view(_app *p_app, float time);
 
 #endif
@@ -6,5 +6,6 @@ float planet_density(_planet_type type);
 u32 planet_colour(_planet_type type);
 void set_radius(_solar_object *obj);
 void set_colour(_solar_object *obj);
+void camera_matrices(_app *p_app, mat4 view, mat4 proj);
 
 #endif
@@ -0,0 +1,16 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "define.h"
+
+#define MESH_VERTEX_CACHE_SIZE 16
+
+u16 float_to_half(float value);
+i16 float_to_snorm16(float value);
+void pack_vertex(const float pos[3], const float uv[2], const float norm[3], _vertex *p_vertex);
+
+void optimize_vertex_cache(u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size);
+u32 optimize_vertex_fetch(_vertex *vertices, u32 *indices, u32 index_count, u32 vertex_count);
+float average_cache_miss_ratio(const u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size);
+
+#endif
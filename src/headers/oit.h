@@ -0,0 +1,18 @@
+#ifndef OIT_H
+#define OIT_H
+
+#include "define.h"
+
+#define OIT_ACCUM_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define OIT_REVEALAGE_FORMAT VK_FORMAT_R16_SFLOAT
+
+void create_oit_resources(_app *p_app);
+void create_oit_descriptor_set_layout(_app *p_app);
+void create_oit_pipeline(_app *p_app);
+void create_oit_descriptor_pool(_app *p_app);
+void write_oit_descriptor_set(_app *p_app, u32 frame_index);
+void create_oit_descriptor_sets(_app *p_app);
+
+void retire_oit_resources(_app *p_app, u32 frame_index);
+
+#endif
@@ -3,8 +3,16 @@
 
 #include "define.h"
 
-char* read_file(_app *p_app, const char *filename, size_t* shader_code_size);
+#define PIPELINE_MAX_THREADS 8
+
+void create_pipeline_cache(_app *p_app);
+void save_pipeline_cache(_app *p_app);
+void destroy_pipeline_cache(_app *p_app);
+VkResult create_cached_graphics_pipeline(_app *p_app, const VkGraphicsPipelineCreateInfo *info, VkPipeline *p_pipeline);
+VkResult create_cached_compute_pipeline(_app *p_app, const VkComputePipelineCreateInfo *info, VkPipeline *p_pipeline);
+double elapsed_ms(const struct timespec *from);
+void compile_pipelines(_app *p_app, _pipeline_job *jobs, u32 count);
 void create_graphics_pipelines(_app *p_app);
-VkShaderModule create_shader_module(_app *p_app, const char* shader_code, size_t shader_code_size);
+VkShaderModule create_shader_module(_app *p_app, _shader_code shader_code);
 
 #endif
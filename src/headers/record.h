@@ -0,0 +1,20 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "define.h"
+
+#define RECORD_THREAD_THRESHOLD 4096
+
+void create_record_pools(_app *p_app);
+void create_secondary_command_buffers(_app *p_app);
+VkCommandBuffer get_secondary_command_buffer(_app *p_app, _record_pass pass);
+void record_secondary_command_buffers(_app *p_app, u32 image_index);
+void create_static_command_buffers(_app *p_app);
+void invalidate_static_command_buffers(_app *p_app, u32 frame_index);
+void prepare_static_command_buffers(_app *p_app, u32 image_index);
+VkCommandBuffer get_static_command_buffer(_app *p_app, u32 image_index, _static_pass pass);
+void retire_static_command_buffers(_app *p_app, u32 frame_index);
+void destroy_static_command_buffers(_app *p_app);
+void destroy_record_pools(_app *p_app);
+
+#endif
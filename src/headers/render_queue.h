@@ -0,0 +1,34 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "define.h"
+
+// sort key layout from the most significant bit down, pass first so passes
+// never interleave, then the state that is most expensive to change
+#define RENDER_QUEUE_PASS_BITS 4
+#define RENDER_QUEUE_PIPELINE_BITS 12
+#define RENDER_QUEUE_MESH_BITS 12
+#define RENDER_QUEUE_MATERIAL_BITS 12
+#define RENDER_QUEUE_DEPTH_BITS 24
+
+#define RENDER_QUEUE_DEPTH_SHIFT 0
+#define RENDER_QUEUE_MATERIAL_SHIFT (RENDER_QUEUE_DEPTH_SHIFT + RENDER_QUEUE_DEPTH_BITS)
+#define RENDER_QUEUE_MESH_SHIFT (RENDER_QUEUE_MATERIAL_SHIFT + RENDER_QUEUE_MATERIAL_BITS)
+#define RENDER_QUEUE_PIPELINE_SHIFT (RENDER_QUEUE_MESH_SHIFT + RENDER_QUEUE_MESH_BITS)
+#define RENDER_QUEUE_PASS_SHIFT (RENDER_QUEUE_PIPELINE_SHIFT + RENDER_QUEUE_PIPELINE_BITS)
+
+#define RENDER_QUEUE_MAX_STATES (1u << 12)
+#define RENDER_QUEUE_INITIAL_CAPACITY 64
+#define RENDER_QUEUE_INSERTION_THRESHOLD 64
+#define RENDER_QUEUE_COHERENT_MOVES_PER_ITEM 4
+#define RENDER_QUEUE_COHERENT_DESCENT_RATIO 16
+
+void create_render_queue(_render_queue *queue);
+void begin_render_queue(_render_queue *queue);
+void push_render_queue(_render_queue *queue, u32 pass, float depth, const _draw_packet *packet);
+void sort_render_queue(_render_queue *queue);
+void submit_render_queue(_app *p_app, _render_queue *queue, VkCommandBuffer command_buffer);
+void destroy_render_queue(_render_queue *queue);
+void benchmark_render_queue_sort();
+
+#endif
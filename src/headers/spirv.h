@@ -0,0 +1,32 @@
+#ifndef SPIRV_H
+#define SPIRV_H
+
+#include "define.h"
+
+// every shader is linked into the binary by spirv.c, a start and end symbol
+// pair per module
+#define DECLARE_SPIRV(name) \
+	extern const u32 spirv_##name[]; \
+	extern const u32 spirv_##name##_end[];
+
+#define SPIRV(name) ((_shader_code){ \
+	.code = spirv_##name, \
+	.size = (size_t)((const char *)spirv_##name##_end - (const char *)spirv_##name), \
+})
+
+DECLARE_SPIRV(mesh_vert)
+DECLARE_SPIRV(mesh_frag)
+DECLARE_SPIRV(billboard_vert)
+DECLARE_SPIRV(billboard_frag)
+DECLARE_SPIRV(grid_vert)
+DECLARE_SPIRV(grid_frag)
+DECLARE_SPIRV(lens_vert)
+DECLARE_SPIRV(lens_frag)
+DECLARE_SPIRV(composite_frag)
+DECLARE_SPIRV(point_vert)
+DECLARE_SPIRV(point_frag)
+DECLARE_SPIRV(cull_comp)
+DECLARE_SPIRV(impostor_vert)
+DECLARE_SPIRV(impostor_frag)
+
+#endif
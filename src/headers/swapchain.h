@@ -14,7 +14,7 @@ void create_image_views(_app *p_app);
 
 void create_framebuffers(_app *p_app);
 
-void cleanup_swapchain(_app *p_app);
 void recreate_swapchain(_app *p_app);
+void refresh_target_descriptors(_app *p_app, u32 frame_index);
 
 #endif
@@ -4,5 +4,10 @@
 #include "define.h"
 
 void create_sync_objects(_app *p_app);
+void grow_render_finished_semaphores(_app *p_app);
+uint64_t next_timeline_value(_app *p_app);
+uint64_t completed_timeline_value(_app *p_app);
+void wait_timeline_value(_app *p_app, uint64_t value);
+void destroy_sync_objects(_app *p_app);
 
 #endif
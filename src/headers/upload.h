@@ -0,0 +1,19 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include "define.h"
+
+#define UPLOAD_RING_SIZE (16u << 20)
+#define UPLOAD_BATCH_COUNT 4
+#define UPLOAD_ALIGNMENT 16
+
+void create_upload(_app *p_app);
+void *stage_upload(_app *p_app, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkDeviceSize size);
+void upload_buffer(_app *p_app, VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+void upload_copy_buffer(_app *p_app, VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
+uint64_t flush_upload(_app *p_app);
+void wait_upload(_app *p_app, uint64_t value);
+bool take_upload_wait(_app *p_app, uint64_t *p_value);
+void destroy_upload(_app *p_app);
+
+#endif
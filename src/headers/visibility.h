@@ -0,0 +1,10 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "define.h"
+
+void create_visibility(_app *p_app);
+void classify_visibility(_app *p_app);
+void destroy_visibility(_app *p_app);
+
+#endif
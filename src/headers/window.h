@@ -4,8 +4,12 @@
 #include "define.h"
 
 void window_init(_app *p_app);
+void note_input(_app *p_app);
 void framebuffer_resize_callback(GLFWwindow* window, int width, int height);
+bool turn_camera(_app *p_app, double xpos, double ypos);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
+void pick_focus(_app *p_app, double xpos, double ypos);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
 #endif
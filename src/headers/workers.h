@@ -0,0 +1,10 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include "define.h"
+
+void create_workers(_app *p_app);
+void run_worker_tasks(_app *p_app, _worker_task task, u32 count, bool threaded);
+void destroy_workers(_app *p_app);
+
+#endif
@@ -3,6 +3,8 @@
 #include "headers/swapchain.h"
 #include "headers/image.h"
 #include "headers/pipeline.h"
+#include "headers/record.h"
+#include "headers/deletion.h"
 
 void create_lens_render_pass(_app *p_app) {
 	VkAttachmentDescription colour = {
@@ -145,16 +147,16 @@ void create_lens_descriptor_set_layout(_app *p_app) {
 
 void create_lens_descriptor_pool(_app *p_app) {
 	VkDescriptorPoolSize sizes[] = {
-		{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = MAX_FRAMES_IN_FLIGHT },
-		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = MAX_FRAMES_IN_FLIGHT },
-		{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MAX_FRAMES_IN_FLIGHT },
+		{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = p_app->sync.frames_in_flight },
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = p_app->sync.frames_in_flight },
+		{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = p_app->sync.frames_in_flight },
 	};
 
 	VkDescriptorPoolCreateInfo info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 		.poolSizeCount = sizeof(sizes) / sizeof(sizes[0]),
 		.pPoolSizes = sizes,
-		.maxSets = MAX_FRAMES_IN_FLIGHT,
+		.maxSets = p_app->sync.frames_in_flight,
 	};
 
 	if (vkCreateDescriptorPool(p_app->device.logical, &info, NULL, &p_app->lens.descriptor.pool) != VK_SUCCESS) {
@@ -163,64 +165,62 @@ void create_lens_descriptor_pool(_app *p_app) {
 	}
 }
 
-void write_lens_descriptor_sets(_app *p_app) {
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		VkDescriptorBufferInfo ubo_info = {
-			.buffer = p_app->uniform.buffers[i],
-			.offset = 0,
-			.range = VK_WHOLE_SIZE,
-		};
-		VkDescriptorBufferInfo sbo_info = {
-			.buffer = p_app->storage.solar_object_buffers[i],
-			.offset = 0,
-			.range = VK_WHOLE_SIZE,
-		};
-		VkDescriptorImageInfo img_info = {
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			.imageView = p_app->resolve.image_view,
-			.sampler = p_app->lens.target.sampler,
-		};
-
-		VkWriteDescriptorSet writes[] = {
-			{
-				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.dstSet = p_app->lens.descriptor.sets[i],
-				.dstBinding = 0,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				.descriptorCount = 1,
-				.pBufferInfo = &ubo_info,
-			},
-			{
-				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.dstSet = p_app->lens.descriptor.sets[i],
-				.dstBinding = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-				.descriptorCount = 1,
-				.pBufferInfo = &sbo_info,
-			},
-			{
-				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.dstSet = p_app->lens.descriptor.sets[i],
-				.dstBinding = 2,
-				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.descriptorCount = 1,
-				.pImageInfo = &img_info,
-			},
-		};
-
-		vkUpdateDescriptorSets(p_app->device.logical, sizeof(writes) / sizeof(writes[0]), writes, 0, NULL);
-	}
+void write_lens_descriptor_set(_app *p_app, u32 frame_index) {
+	VkDescriptorBufferInfo ubo_info = {
+		.buffer = p_app->uniform.buffers[frame_index],
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	VkDescriptorBufferInfo sbo_info = {
+		.buffer = p_app->storage.solar_objects[frame_index].buffer,
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	VkDescriptorImageInfo img_info = {
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.imageView = p_app->resolve.image_view,
+		.sampler = p_app->lens.target.sampler,
+	};
+
+	VkWriteDescriptorSet writes[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->lens.descriptor.sets[frame_index],
+			.dstBinding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.pBufferInfo = &ubo_info,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->lens.descriptor.sets[frame_index],
+			.dstBinding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.pBufferInfo = &sbo_info,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->lens.descriptor.sets[frame_index],
+			.dstBinding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.pImageInfo = &img_info,
+		},
+	};
+
+	vkUpdateDescriptorSets(p_app->device.logical, sizeof(writes) / sizeof(writes[0]), writes, 0, NULL);
 }
 
 void create_lens_descriptor_sets(_app *p_app) {
-	p_app->lens.descriptor.sets = malloc(sizeof(VkDescriptorSet) * MAX_FRAMES_IN_FLIGHT);
-	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * MAX_FRAMES_IN_FLIGHT);
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) layouts[i] = p_app->lens.pass.descriptor_set_layout;
+	p_app->lens.descriptor.sets = malloc(sizeof(VkDescriptorSet) * p_app->sync.frames_in_flight);
+	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * p_app->sync.frames_in_flight);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) layouts[i] = p_app->lens.pass.descriptor_set_layout;
 
 	VkDescriptorSetAllocateInfo alloc_info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.descriptorPool = p_app->lens.descriptor.pool,
-		.descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+		.descriptorSetCount = p_app->sync.frames_in_flight,
 		.pSetLayouts = layouts,
 	};
 
@@ -230,20 +230,46 @@ void create_lens_descriptor_sets(_app *p_app) {
 	}
 	free(layouts);
 
-	write_lens_descriptor_sets(p_app);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		write_lens_descriptor_set(p_app, i);
+	}
 }
 
-void create_lens_pipeline(_app *p_app) {
-	size_t vert_size, frag_size;
-	const char *vert_code = read_file(p_app, p_app->shader.lens_vert, &vert_size);
-	const char *frag_code = read_file(p_app, p_app->shader.lens_frag, &frag_size);
-
-	VkShaderModule vert = create_shader_module(p_app, vert_code, vert_size);
-	VkShaderModule frag = create_shader_module(p_app, frag_code, frag_size);
+// steps times the angle step stays at 6.4 radians, enough to bend a ray
+// half way round the hole at every level
+static const _lens_specialization lens_quality_levels[LENS_QUALITY_COUNT] = {
+	[LENS_QUALITY_LOW] = { .max_rk4_steps = 64, .influence_factor = 25.0f, .dphi_base = 0.1f },
+	[LENS_QUALITY_MEDIUM] = { .max_rk4_steps = 256, .influence_factor = 50.0f, .dphi_base = 0.025f },
+	[LENS_QUALITY_HIGH] = { .max_rk4_steps = 1024, .influence_factor = 100.0f, .dphi_base = 0.00625f },
+};
+
+static const char *lens_quality_names[LENS_QUALITY_COUNT] = {
+	[LENS_QUALITY_LOW] = "low",
+	[LENS_QUALITY_MEDIUM] = "medium",
+	[LENS_QUALITY_HIGH] = "high",
+};
+
+// builds one quality of the lens pipeline, only reads state that is fixed
+// once the layout exists so the background thread can call it too
+static VkResult build_lens_variant(_app *p_app, _lens_quality quality, VkPipeline *p_pipeline) {
+	VkShaderModule vert = create_shader_module(p_app, p_app->shader.lens_vert);
+	VkShaderModule frag = create_shader_module(p_app, p_app->shader.lens_frag);
+
+	VkSpecializationMapEntry entries[3] = {
+		{ .constantID = 0, .offset = offsetof(_lens_specialization, max_rk4_steps), .size = sizeof(i32) },
+		{ .constantID = 1, .offset = offsetof(_lens_specialization, influence_factor), .size = sizeof(float) },
+		{ .constantID = 2, .offset = offsetof(_lens_specialization, dphi_base), .size = sizeof(float) },
+	};
+	VkSpecializationInfo specialization = {
+		.mapEntryCount = 3,
+		.pMapEntries = entries,
+		.dataSize = sizeof(_lens_specialization),
+		.pData = &lens_quality_levels[quality],
+	};
 
 	VkPipelineShaderStageCreateInfo stages[2] = {
 		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = vert, .pName = "main" },
-		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = frag, .pName = "main" },
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = frag, .pName = "main", .pSpecializationInfo = &specialization },
 	};
 
 	VkPipelineVertexInputStateCreateInfo vertex_input = {
@@ -255,17 +281,12 @@ void create_lens_pipeline(_app *p_app) {
 		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
 	};
 
-	VkViewport viewport = {
-		.width = (float)p_app->swp.render_extent.width,
-		.height = (float)p_app->swp.render_extent.height,
-		.minDepth = 0.0f, .maxDepth = 1.0f,
-	};
-	VkRect2D scissor = { .extent = p_app->swp.render_extent };
-
+	// viewport and scissor are dynamic, so the swapchain extent is never read
+	// here while a resize may be changing it
 	VkPipelineViewportStateCreateInfo viewport_state = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-		.viewportCount = 1, .pViewports = &viewport,
-		.scissorCount = 1, .pScissors = &scissor,
+		.viewportCount = 1,
+		.scissorCount = 1,
 	};
 
 	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -302,17 +323,6 @@ void create_lens_pipeline(_app *p_app) {
 		.pAttachments = &blend,
 	};
 
-	VkPipelineLayoutCreateInfo layout_info = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = 1,
-		.pSetLayouts = &p_app->lens.pass.descriptor_set_layout,
-	};
-
-	if (vkCreatePipelineLayout(p_app->device.logical, &layout_info, NULL, &p_app->lens.pass.layout) != VK_SUCCESS) {
-		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "lens pipeline layout => failed");
-		exit(EXIT_FAILURE);
-	}
-
 	VkGraphicsPipelineCreateInfo info = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.stageCount = 2,
@@ -329,25 +339,105 @@ void create_lens_pipeline(_app *p_app) {
 		.renderPass = p_app->lens.pass.render_pass,
 	};
 
-	if (vkCreateGraphicsPipelines(p_app->device.logical, VK_NULL_HANDLE, 1, &info, NULL, &p_app->lens.pass.pipeline) != VK_SUCCESS) {
+	VkResult result = vkCreateGraphicsPipelines(p_app->device.logical, p_app->pipeline.cache, 1, &info, NULL, p_pipeline);
+
+	vkDestroyShaderModule(p_app->device.logical, vert, NULL);
+	vkDestroyShaderModule(p_app->device.logical, frag, NULL);
+	return result;
+}
+
+// the requested quality goes first, the rest follow so switching later is
+// instant. a variant that fails keeps its ready bit clear and is never used
+static void *compile_lens_variants(void *p_arg) {
+	_app *p_app = p_arg;
+	_lens_quality requested = p_app->lens.variant.requested;
+
+	for (u32 i = 0; i < LENS_QUALITY_COUNT; i++) {
+		_lens_quality quality = (requested + i) % LENS_QUALITY_COUNT;
+		if (quality == LENS_QUALITY_BASELINE) continue;
+
+		if (build_lens_variant(p_app, quality, &p_app->lens.variant.pipelines[quality]) != VK_SUCCESS) {
+			p_app->lens.variant.pipelines[quality] = VK_NULL_HANDLE;
+			continue;
+		}
+		atomic_fetch_or_explicit(&p_app->lens.variant.ready, 1u << quality, memory_order_release);
+	}
+
+	return NULL;
+}
+
+void create_lens_pipeline(_app *p_app) {
+	VkPipelineLayoutCreateInfo layout_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &p_app->lens.pass.descriptor_set_layout,
+	};
+
+	if (vkCreatePipelineLayout(p_app->device.logical, &layout_info, NULL, &p_app->lens.pass.layout) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "lens pipeline layout => failed");
+		exit(EXIT_FAILURE);
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	VkResult result = build_lens_variant(p_app, LENS_QUALITY_BASELINE, &p_app->lens.variant.pipelines[LENS_QUALITY_BASELINE]);
+	p_app->perf.pipeline_ms += elapsed_ms(&start);
+
+	if (result != VK_SUCCESS) {
 		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "lens pipeline => failed");
 		exit(EXIT_FAILURE);
 	}
 
-	vkDestroyShaderModule(p_app->device.logical, vert, NULL);
-	vkDestroyShaderModule(p_app->device.logical, frag, NULL);
-	free((void*)vert_code);
-	free((void*)frag_code);
+	atomic_init(&p_app->lens.variant.ready, 1u << LENS_QUALITY_BASELINE);
+	p_app->lens.variant.active = LENS_QUALITY_BASELINE;
+	p_app->lens.variant.requested = p_app->config.lens.quality;
+	p_app->lens.pass.pipeline = p_app->lens.variant.pipelines[LENS_QUALITY_BASELINE];
+
+	// with no thread the baseline simply stays in use
+	p_app->lens.variant.thread_started = pthread_create(&p_app->lens.variant.thread, NULL, compile_lens_variants, p_app) == 0;
+}
+
+// moves the lens onto the requested variant once it has compiled. the
+// static lens pass has the old pipeline baked in so every slot re-records,
+// frames still in flight keep using the old one which lives until shutdown
+void select_lens_variant(_app *p_app) {
+	_lens_quality requested = p_app->lens.variant.requested;
+	if (requested == p_app->lens.variant.active) return;
+
+	u32 ready = atomic_load_explicit(&p_app->lens.variant.ready, memory_order_acquire);
+	if (!(ready & (1u << requested))) return;
+
+	p_app->lens.variant.active = requested;
+	p_app->lens.pass.pipeline = p_app->lens.variant.pipelines[requested];
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		invalidate_static_command_buffers(p_app, i);
+	}
+
+	if (p_app->config.win.flags & CONFIG_FLAG_PRINT_FPS) {
+		printf("[perf] Lens Quality: %s\n", lens_quality_names[requested]);
+	}
 }
 
-void cleanup_lens_swapchain(_app *p_app) {
-	vkDestroyFramebuffer(p_app->device.logical, p_app->lens.pass.framebuffer, NULL);
-	vkDestroyImageView(p_app->device.logical, p_app->lens.target.image_view, NULL);
-	vmaDestroyImage(p_app->mem.alloc, p_app->lens.target.image, p_app->lens.target.image_allocation);
+void cycle_lens_quality(_app *p_app) {
+	p_app->lens.variant.requested = (p_app->lens.variant.requested + 1) % LENS_QUALITY_COUNT;
+}
+
+void destroy_lens_pipelines(_app *p_app) {
+	if (p_app->lens.variant.thread_started) {
+		pthread_join(p_app->lens.variant.thread, NULL);
+		p_app->lens.variant.thread_started = false;
+	}
+
+	for (u32 i = 0; i < LENS_QUALITY_COUNT; i++) {
+		vkDestroyPipeline(p_app->device.logical, p_app->lens.variant.pipelines[i], NULL);
+		p_app->lens.variant.pipelines[i] = VK_NULL_HANDLE;
+	}
+	p_app->lens.pass.pipeline = VK_NULL_HANDLE;
 }
 
-void recreate_lens_swapchain(_app *p_app) {
-	create_lens_image(p_app);
-	create_lens_framebuffer(p_app);
-	write_lens_descriptor_sets(p_app);
+// the old target and its framebuffer go on this frame slot's deletion queue,
+// the static lens pass that names them is re-recorded for the new ones
+void retire_lens_target(_app *p_app, u32 frame_index) {
+	defer_framebuffer_destruction(p_app, frame_index, p_app->lens.pass.framebuffer);
+	defer_image_destruction(p_app, frame_index, p_app->lens.target.image, p_app->lens.target.image_view, p_app->lens.target.image_allocation);
 }
@@ -3,6 +3,18 @@
 #include "headers/swapchain.h"
 #include "headers/buffer.h"
 #include "headers/object.h"
+#include "headers/deletion.h"
+#include "headers/descriptors.h"
+#include "headers/bvh.h"
+#include "headers/aggregate.h"
+#include "headers/visibility.h"
+#include "headers/cull.h"
+#include "headers/maths.h"
+#include "headers/record.h"
+#include "headers/sync.h"
+#include "headers/upload.h"
+#include "headers/lens.h"
+#include "headers/window.h"
 
 void log_performance(_app *p_app) {
 	struct timespec now;
@@ -26,7 +38,11 @@ void log_performance(_app *p_app) {
 	p_app->perf.frame_count++;
 	if (p_app->config.win.flags & CONFIG_FLAG_PRINT_FPS) {
 		if (p_app->perf.frame_count % 60 == 0) {
-			printf("[perf] FPS: %.1f, Frame Time: %.2f ms\n", p_app->perf.fps_avg, p_app->perf.frame_time_avg * 1000.0f);
+			printf("[perf] FPS: %.1f, Frame Time: %.2f ms, Sphere Triangles: %llu\n", p_app->perf.fps_avg, p_app->perf.frame_time_avg * 1000.0f, (unsigned long long)p_app->perf.triangle_count);
+			_render_queue_stats *binds = &p_app->perf.binds;
+			printf("[perf] Draws: %u, Binds: %u pipeline, %u vertex, %u index, %u descriptor\n", binds->draws, binds->pipeline_binds, binds->vertex_binds, binds->index_binds, binds->descriptor_binds);
+			if (p_app->perf.input_to_gpu_ms > 0.0)
+				printf("[perf] Input To GPU Done: %.2f ms\n", p_app->perf.input_to_gpu_ms);
 		}
 	}
 }
@@ -43,8 +59,76 @@ float get_delta_time() {
 	return delta;
 }
 
+// completes the samples of every frame the gpu has finished, the first
+// sample seeds the average. reading the counter never blocks, so this runs
+// at each point the cpu could next see a frame finish
+static void sample_input_to_gpu(_app *p_app) {
+	uint64_t completed = completed_timeline_value(p_app);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		_latched_input *latched = &p_app->perf.latched[i];
+		if (!latched->pending || latched->value > completed) continue;
+
+		double ms = (now.tv_sec - latched->input_time.tv_sec) * 1e3 + (now.tv_nsec - latched->input_time.tv_nsec) / 1e6;
+		if (p_app->perf.input_to_gpu_ms == 0.0) {
+			p_app->perf.input_to_gpu_ms = ms;
+		} else {
+			p_app->perf.input_to_gpu_ms += (ms - p_app->perf.input_to_gpu_ms) * 0.05;
+		}
+		latched->pending = false;
+	}
+}
+
+// samples the cursor once more just before submit and rewrites only the
+// camera matrices of this slot's ubo. events are left to the main loop,
+// only the position is read so no callback runs mid frame. the mapping
+// is coherent and the recorded work reads the ubo when it runs, so the
+// submit picks the new view up. culling already used the camera from the
+// top of the frame, only the view direction is latched so that gap is at
+// most one frame of turning
+static void latch_camera(_app *p_app, u32 frame_index, uint64_t frame_value) {
+	if (p_app->view.mouse_locked) {
+		double xpos, ypos;
+		glfwGetCursorPos(p_app->win.window, &xpos, &ypos);
+		if (turn_camera(p_app, xpos, ypos)) note_input(p_app);
+
+		vec3 front;
+		front[0] = cos(glm_rad(p_app->view.yaw)) * cos(glm_rad(p_app->view.pitch));
+		front[1] = sin(glm_rad(p_app->view.pitch));
+		front[2] = sin(glm_rad(p_app->view.yaw)) * cos(glm_rad(p_app->view.pitch));
+		glm_vec3_normalize(front);
+		glm_vec3_add(p_app->view.camera_pos, front, p_app->view.target);
+	}
+
+	_ubo camera;
+	camera_matrices(p_app, camera.view, camera.proj);
+	glm_mat4_inv(camera.proj, camera.inv_proj);
+	glm_mat4_inv(camera.view, camera.inv_view);
+	memcpy(p_app->uniform.buffers_mapped[frame_index], &camera, UBO_CAMERA_SIZE);
+
+	if (p_app->perf.input_pending) {
+		p_app->perf.latched[frame_index] = (_latched_input){
+			.input_time = p_app->perf.input_time,
+			.value = frame_value,
+			.pending = true,
+		};
+		p_app->perf.input_pending = false;
+	}
+}
+
 void draw_frame(_app *p_app) {
-	vkWaitForFences(p_app->device.logical, 1, &p_app->sync.in_flight_fences[p_app->sync.frame_index], VK_TRUE, UINT64_MAX);
+	// the slot's previous submission has to finish before its buffers are
+	// reused, the wait is on that exact value so later frames keep running.
+	// frames that finished while the cpu was elsewhere are sampled before
+	// blocking, the one waited on right as the wait returns
+	sample_input_to_gpu(p_app);
+	wait_timeline_value(p_app, p_app->sync.frame_values[p_app->sync.frame_index]);
+	sample_input_to_gpu(p_app);
+	flush_deletion_queue(p_app, p_app->sync.frame_index);
+	refresh_target_descriptors(p_app, p_app->sync.frame_index);
+	select_lens_variant(p_app);
 
 	u32 image_index;
 	VkResult aquire_result = vkAcquireNextImageKHR(
@@ -56,8 +140,11 @@ void draw_frame(_app *p_app) {
 		&image_index
 	);
 
+	// the retired swapchain belongs to this slot now, moving on to the next
+	// slot keeps the following frame from waiting on the one just submitted
 	if (aquire_result == VK_ERROR_OUT_OF_DATE_KHR) {
 		recreate_swapchain(p_app);
+		p_app->sync.frame_index = (p_app->sync.frame_index + 1) % p_app->sync.frames_in_flight;
 		return;
 	} else if (aquire_result != VK_SUCCESS && aquire_result != VK_SUBOPTIMAL_KHR) {
 
@@ -70,31 +157,57 @@ void draw_frame(_app *p_app) {
 	}
 
 	calculate_gravity(p_app);
-	update_billboard_positions(p_app);
+	update_bvh(p_app);
+	update_aggregates(p_app);
+	classify_visibility(p_app);
 	update_uniform_buffer(p_app, p_app->sync.frame_index);
 	update_storage_buffers(p_app, p_app->sync.frame_index);
-
-	vkResetFences(p_app->device.logical, 1, &p_app->sync.in_flight_fences[p_app->sync.frame_index]);
+	update_cull_buffers(p_app, p_app->sync.frame_index);
 
 	vkResetCommandBuffer(p_app->cmd.buffers[p_app->sync.frame_index], 0);
 	record_command_buffer(p_app, p_app->cmd.buffers[p_app->sync.frame_index], image_index);
 
-	VkSemaphore wait_semaphores[] = {p_app->sync.image_available_semaphores[p_app->sync.frame_index]};
-	VkSemaphore signal_semaphores[] = {p_app->sync.render_finished_semaphores[image_index]};
-	VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT};
+	VkSemaphore wait_semaphores[] = {p_app->sync.image_available_semaphores[p_app->sync.frame_index], p_app->upload.timeline};
+	VkSemaphore signal_semaphores[] = {p_app->sync.render_finished_semaphores[image_index], p_app->sync.timeline};
+	VkPipelineStageFlags wait_stages[] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	};
+
+	// binary semaphores ignore their value, only the timelines' are read.
+	// uploads flushed since the last frame are waited on by the gpu, the
+	// copies themselves overlap the frames already in flight
+	uint64_t frame_value = next_timeline_value(p_app);
+	uint64_t upload_value = 0;
+	u32 wait_count = take_upload_wait(p_app, &upload_value) ? 2 : 1;
+	uint64_t wait_values[] = {0, upload_value};
+	uint64_t signal_values[] = {0, frame_value};
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = wait_count,
+		.pWaitSemaphoreValues = wait_values,
+		.signalSemaphoreValueCount = 2,
+		.pSignalSemaphoreValues = signal_values,
+	};
 
 	VkSubmitInfo submit_info = {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
+		.pNext = &timeline_info,
+		.waitSemaphoreCount = wait_count,
 		.pWaitSemaphores = wait_semaphores,
 		.pWaitDstStageMask = wait_stages,
 		.commandBufferCount = 1,
 		.pCommandBuffers = &p_app->cmd.buffers[p_app->sync.frame_index],
-		.signalSemaphoreCount = 1,
+		.signalSemaphoreCount = 2,
 		.pSignalSemaphores = signal_semaphores,
 	};
 
-	if (vkQueueSubmit(p_app->device.graphics_queue, 1, &submit_info, p_app->sync.in_flight_fences[p_app->sync.frame_index]) != VK_SUCCESS) {
+	p_app->sync.frame_values[p_app->sync.frame_index] = frame_value;
+
+	latch_camera(p_app, p_app->sync.frame_index, frame_value);
+
+	if (vkQueueSubmit(p_app->device.graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
 		submit_debug_message(
 			p_app->inst.instance,
 			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
@@ -107,7 +220,7 @@ void draw_frame(_app *p_app) {
 	VkPresentInfoKHR present_info = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = signal_semaphores,
+		.pWaitSemaphores = &signal_semaphores[0],
 		.swapchainCount = 1,
 		.pSwapchains = swapchains,
 		.pImageIndices = &image_index,
@@ -115,11 +228,24 @@ void draw_frame(_app *p_app) {
 	};
 
 	VkResult present_result = vkQueuePresentKHR(p_app->device.present_queue, &present_info);
+	sample_input_to_gpu(p_app);
+	if (present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR) {
+		release_retired_swapchains(p_app);
+	}
+
+	if (!p_app->perf.first_frame_presented) {
+		p_app->perf.first_frame_presented = true;
+		if (p_app->config.win.flags & CONFIG_FLAG_PRINT_FPS) {
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			double ms = (now.tv_sec - p_app->perf.start_time.tv_sec) * 1e3 + (now.tv_nsec - p_app->perf.start_time.tv_nsec) / 1e6;
+			printf("[perf] Time To First Frame: %.2f ms\n", ms);
+		}
+	}
 
 	if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR || p_app->swp.framebuffer_resized) {
 		p_app->swp.framebuffer_resized = false;
 		recreate_swapchain(p_app);
-		return;
 	} else if (present_result != VK_SUCCESS) {
 		submit_debug_message(
 			p_app->inst.instance,
@@ -129,7 +255,7 @@ void draw_frame(_app *p_app) {
 		exit(EXIT_FAILURE);
 	}
 
-	p_app->sync.frame_index = (p_app->sync.frame_index + 1) % MAX_FRAMES_IN_FLIGHT;
+	p_app->sync.frame_index = (p_app->sync.frame_index + 1) % p_app->sync.frames_in_flight;
 }
 
 void update_uniform_buffer(_app *p_app, u32 current_image) {
@@ -145,12 +271,7 @@ void update_uniform_buffer(_app *p_app, u32 current_image) {
 
 	_ubo ubo;
 
-	glm_lookat(p_app->view.camera_pos, p_app->view.target, p_app->view.world_up, ubo.view);
-
-	float aspect = (float)p_app->swp.extent.width / (float)p_app->swp.extent.height;
-	glm_perspective(glm_rad(p_app->view.fov_y), aspect,
-								 p_app->view.near_plane, p_app->view.far_plane, ubo.proj);
-	ubo.proj[1][1] *= -1;
+	camera_matrices(p_app, ubo.view, ubo.proj);
 
 	glm_mat4_inv(ubo.proj, ubo.inv_proj);
 	glm_mat4_inv(ubo.view, ubo.inv_view);
@@ -168,25 +289,50 @@ void update_uniform_buffer(_app *p_app, u32 current_image) {
 }
 
 void update_storage_buffers(_app *p_app, u32 current_image) {
-    size_t required_billboard_buffer_size    = SBO_HEADER_SIZE + (p_app->obj.billboard_count    * sizeof(_billboard));
-    size_t required_solar_object_buffer_size = SBO_HEADER_SIZE + (p_app->obj.solar_object_count * sizeof(_solar_object));
-
-    if (required_billboard_buffer_size > p_app->storage.billboard_current_buffer_size) {
-        recreate_billboard_storage_buffers(p_app, required_billboard_buffer_size * 2);
-    }
-    if (required_solar_object_buffer_size > p_app->storage.solar_object_current_buffer_size) {
-        recreate_solar_object_storage_buffers(p_app, required_solar_object_buffer_size * 2);
-    }
-
-    uint8_t *dest = (uint8_t*)p_app->storage.billboard_buffers_mapped[current_image];
-    memcpy(dest, &p_app->obj.billboard_count, sizeof(uint32_t));
-    if (p_app->obj.billboard_count > 0)
-        memcpy(dest + SBO_HEADER_SIZE, p_app->obj.billboards, p_app->obj.billboard_count * sizeof(_billboard));
-
-    dest = (uint8_t*)p_app->storage.solar_object_buffers_mapped[current_image];
-    memcpy(dest, &p_app->obj.solar_object_count, sizeof(uint32_t));
-    if (p_app->obj.solar_object_count > 0)
-        memcpy(dest + SBO_HEADER_SIZE, p_app->obj.solar_objects, p_app->obj.solar_object_count * sizeof(_solar_object));
+	u32 billboard_total = p_app->obj.billboard_count + p_app->aggregate.impostor_count;
+	VkDeviceSize required_billboard_buffer_size    = SBO_HEADER_SIZE + (billboard_total * sizeof(_billboard));
+	VkDeviceSize required_solar_object_buffer_size = SBO_HEADER_SIZE + (p_app->obj.solar_object_count * sizeof(_solar_object));
+	VkDeviceSize required_instance_buffer_size = sizeof(u32) * (p_app->visibility.instance_count + 1);
+
+	_mapped_buffer *billboards = &p_app->storage.billboards[current_image];
+	_mapped_buffer *solar_objects = &p_app->storage.solar_objects[current_image];
+	_mapped_buffer *instances = &p_app->storage.instances[current_image];
+
+	bool billboards_grown = grow_mapped_buffer(p_app, current_image, billboards, required_billboard_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	if (billboards_grown) {
+		update_storage_descriptor(p_app, p_app->descriptor.sets[current_image], 1, billboards->buffer);
+		invalidate_static_command_buffers(p_app, current_image);
+	}
+	if (grow_mapped_buffer(p_app, current_image, solar_objects, required_solar_object_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+		update_storage_descriptor(p_app, p_app->descriptor.sets[current_image], 2, solar_objects->buffer);
+		update_storage_descriptor(p_app, p_app->lens.descriptor.sets[current_image], 1, solar_objects->buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[current_image], 1, solar_objects->buffer);
+		invalidate_static_command_buffers(p_app, current_image);
+	}
+	if (grow_mapped_buffer(p_app, current_image, instances, required_instance_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+		update_storage_descriptor(p_app, p_app->descriptor.sets[current_image], 3, instances->buffer);
+		update_storage_descriptor(p_app, p_app->cull.sets[current_image], 2, instances->buffer);
+		invalidate_static_command_buffers(p_app, current_image);
+	}
+
+	// body billboards only hold appearance data now, so they are copied
+	// into each frame slot once after a change, impostors follow every frame
+	uint8_t *dest = (uint8_t*)billboards->mapped;
+	memcpy(dest, &billboard_total, sizeof(uint32_t));
+	if (p_app->obj.billboard_count > 0 && (billboards_grown || p_app->obj.billboard_dirty_frames > 0))
+		memcpy(dest + SBO_HEADER_SIZE, p_app->obj.billboards, p_app->obj.billboard_count * sizeof(_billboard));
+	if (p_app->obj.billboard_dirty_frames > 0)
+		p_app->obj.billboard_dirty_frames--;
+	if (p_app->aggregate.impostor_count > 0)
+		memcpy(dest + SBO_HEADER_SIZE + p_app->obj.billboard_count * sizeof(_billboard), p_app->aggregate.impostors, p_app->aggregate.impostor_count * sizeof(_billboard));
+
+	dest = (uint8_t*)solar_objects->mapped;
+	memcpy(dest, &p_app->obj.solar_object_count, sizeof(uint32_t));
+	if (p_app->obj.solar_object_count > 0)
+		memcpy(dest + SBO_HEADER_SIZE, p_app->obj.solar_objects, p_app->obj.solar_object_count * sizeof(_solar_object));
+
+	if (p_app->visibility.instance_count > 0)
+		memcpy(instances->mapped, p_app->visibility.instances, p_app->visibility.instance_count * sizeof(u32));
 }
 
 void update_billboards(_app *p_app) {
@@ -208,6 +354,38 @@ void update_billboards(_app *p_app) {
 	}
 }
 
+void update_focus(_app *p_app, float time) {
+	if (p_app->view.focus_index >= p_app->obj.solar_object_count) {
+		p_app->view.focus_index = UINT32_MAX;
+		return;
+	}
+
+	_solar_object *obj = &p_app->obj.solar_objects[p_app->view.focus_index];
+
+	vec3 to_focus;
+	glm_vec3_sub(obj->position, p_app->view.camera_pos, to_focus);
+	float distance = glm_vec3_norm(to_focus);
+	if (distance <= 0.0f) return;
+	glm_vec3_scale(to_focus, 1.0f / distance, to_focus);
+
+	float t = p_app->view.lerp_speed * time * 60.0f;
+	if (t > 1.0f) t = 1.0f;
+
+	float goal_yaw = glm_deg(atan2f(to_focus[2], to_focus[0]));
+	float goal_pitch = glm_deg(asinf(to_focus[1]));
+	if (goal_pitch > 89.0f) goal_pitch = 89.0f;
+	if (goal_pitch < -89.0f) goal_pitch = -89.0f;
+
+	float yaw_diff = fmodf(goal_yaw - p_app->view.yaw + 540.0f, 360.0f) - 180.0f;
+	p_app->view.yaw += yaw_diff * t;
+	p_app->view.pitch += (goal_pitch - p_app->view.pitch) * t;
+
+	float goal_distance = obj->radius * p_app->view.focus_distance_multiplier;
+	vec3 step;
+	glm_vec3_scale(to_focus, (distance - goal_distance) * t, step);
+	glm_vec3_add(p_app->view.camera_pos, step, p_app->view.camera_pos);
+}
+
 void update_view(_app *p_app, float time) {
 	if (glfwGetKey(p_app->win.window, GLFW_KEY_ESCAPE) == GLFW_PRESS && p_app->view.mouse_locked) {
 		glfwSetInputMode(p_app->win.window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -215,7 +393,10 @@ void update_view(_app *p_app, float time) {
 		p_app->view.first_mouse = true;
 	}
 
-	if (!p_app->view.mouse_locked) return;
+	bool focusing = p_app->view.focus_index != UINT32_MAX;
+	if (!p_app->view.mouse_locked && !focusing) return;
+
+	if (focusing) update_focus(p_app, time);
 
 	vec3 front;
 	front[0] = cos(glm_rad(p_app->view.yaw)) * cos(glm_rad(p_app->view.pitch));
@@ -234,18 +415,24 @@ void update_view(_app *p_app, float time) {
 	glm_vec3_cross(right, front, up);
 	glm_vec3_normalize(up);
 
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_W) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[1] = p_app->view.speed;
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_S) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[1] = -p_app->view.speed;
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_A) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[0] = -p_app->view.speed;
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_D) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[0] = p_app->view.speed;
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[2] = -p_app->view.speed;
-	if (glfwGetKey(p_app->win.window, GLFW_KEY_SPACE) == GLFW_PRESS)
-		p_app->view.cam_offset_goal[2] = p_app->view.speed;
+	if (p_app->view.mouse_locked) {
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_W) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[1] = p_app->view.speed;
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_S) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[1] = -p_app->view.speed;
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_A) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[0] = -p_app->view.speed;
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_D) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[0] = p_app->view.speed;
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[2] = -p_app->view.speed;
+		if (glfwGetKey(p_app->win.window, GLFW_KEY_SPACE) == GLFW_PRESS)
+			p_app->view.cam_offset_goal[2] = p_app->view.speed;
+	}
+
+	// any manual movement hands the camera back from the focused body
+	if (glm_vec3_norm2(p_app->view.cam_offset_goal) > 0.0f)
+		p_app->view.focus_index = UINT32_MAX;
 
 	for (int i = 0; i < 3; ++i) {
 		float diff = p_app->view.cam_offset_goal[i] - p_app->view.cam_offset[i];
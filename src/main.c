@@ -15,13 +15,21 @@
 #include "headers/loop.h"
 #include "headers/object.h"
 #include "headers/lens.h"
+#include "headers/oit.h"
+#include "headers/deletion.h"
+#include "headers/bvh.h"
+#include "headers/aggregate.h"
+#include "headers/visibility.h"
+#include "headers/cull.h"
+#include "headers/record.h"
+#include "headers/upload.h"
+#include "headers/render_queue.h"
+#include "headers/workers.h"
 
 void vulkan_init(_app *p_app);
 void clean(_app *p_app);
 void main_loop(_app *p_app);
 
-const u32 MAX_FRAMES_IN_FLIGHT = 2;
-
 u32 clamp(u32 n, u32 min, u32 max) {
 	if (n < min) return min;
 	if (n > max) return max;
@@ -30,7 +38,9 @@ u32 clamp(u32 n, u32 min, u32 max) {
 
 int main() {
 	_app app = {0};
+	clock_gettime(CLOCK_MONOTONIC, &app.perf.start_time);
 	app_init(&app);
+	if (app.config.win.flags & CONFIG_FLAG_BENCHMARK_SORT) benchmark_render_queue_sort();
 	window_init(&app);
 	vulkan_init(&app);
 	main_loop(&app);
@@ -48,22 +58,40 @@ void vulkan_init(_app *p_app) {
 	create_image_views(p_app);
 	create_render_pass(p_app);
 	create_descriptor_set_layout(p_app);
+	create_pipeline_cache(p_app);
 	create_graphics_pipelines(p_app);
 	create_command_pool(p_app);
+	create_workers(p_app);
+	create_record_pools(p_app);
+	create_upload(p_app);
 	create_colour_resources(p_app);
 	create_depth_resources(p_app);
 	create_resolve_resources(p_app);
+	create_oit_resources(p_app);
 	create_framebuffers(p_app);
 	create_billboards(p_app);
+	create_bvh(p_app);
+	create_aggregates(p_app);
+	create_visibility(p_app);
 	create_billboard_buffer(p_app);
 	create_grid_lines(p_app);
 	create_grid_buffer(p_app);
 	create_spheres(p_app);
 	create_mesh_buffer(p_app);
 	create_uniform_buffers(p_app);
+	create_deletion_queues(p_app);
 	create_storage_buffers(p_app);
 	create_descriptor_pool(p_app);
 	create_descriptor_sets(p_app);
+	create_cull_descriptor_set_layout(p_app);
+	create_cull_pipeline(p_app);
+	create_cull_buffers(p_app);
+	create_cull_descriptor_pool(p_app);
+	create_cull_descriptor_sets(p_app);
+	create_oit_descriptor_set_layout(p_app);
+	create_oit_pipeline(p_app);
+	create_oit_descriptor_pool(p_app);
+	create_oit_descriptor_sets(p_app);
 	create_lens_render_pass(p_app);
 	create_lens_image(p_app);
 	create_lens_framebuffer(p_app);
@@ -73,7 +101,17 @@ void vulkan_init(_app *p_app) {
 	create_lens_descriptor_pool(p_app);
 	create_lens_descriptor_sets(p_app);
 	create_command_buffers(p_app);
+	create_secondary_command_buffers(p_app);
+	create_static_command_buffers(p_app);
 	create_sync_objects(p_app);
+
+	// every startup copy was staged into the upload ring, they go out in one
+	// submit here and the first frame waits on it on the gpu
+	flush_upload(p_app);
+	if (p_app->config.win.flags & CONFIG_FLAG_PRINT_FPS) {
+		printf("[perf] Startup Uploads: %u copies, %.1f KiB, %llu submits\n", p_app->upload.copies, p_app->upload.bytes / 1024.0, (unsigned long long)p_app->upload.submitted);
+		printf("[perf] Pipeline Compile: %.2f ms (%s cache)\n", p_app->perf.pipeline_ms, p_app->pipeline.cache_warm ? "warm" : "cold");
+	}
 }
 
 void main_loop(_app *p_app) {
@@ -97,6 +135,10 @@ void clean(_app *p_app) {
 	vmaDestroyImage(p_app->mem.alloc, p_app->resolve.image, p_app->resolve.image_allocation);
 	vkDestroyImageView(p_app->device.logical, p_app->lens.target.image_view, NULL);
 	vmaDestroyImage(p_app->mem.alloc, p_app->lens.target.image, p_app->lens.target.image_allocation);
+	vkDestroyImageView(p_app->device.logical, p_app->oit.accum.image_view, NULL);
+	vmaDestroyImage(p_app->mem.alloc, p_app->oit.accum.image, p_app->oit.accum.image_allocation);
+	vkDestroyImageView(p_app->device.logical, p_app->oit.revealage.image_view, NULL);
+	vmaDestroyImage(p_app->mem.alloc, p_app->oit.revealage.image, p_app->oit.revealage.image_allocation);
 
 	vkDestroyDescriptorPool(p_app->device.logical, p_app->descriptor.pool, NULL);
 	p_app->descriptor.pool = VK_NULL_HANDLE;
@@ -112,7 +154,14 @@ void clean(_app *p_app) {
 	free(p_app->lens.descriptor.sets);
 	p_app->lens.descriptor.sets = NULL;
 
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	vkDestroyDescriptorPool(p_app->device.logical, p_app->oit.descriptor.pool, NULL);
+	p_app->oit.descriptor.pool = VK_NULL_HANDLE;
+	free(p_app->oit.descriptor.sets);
+	p_app->oit.descriptor.sets = NULL;
+	vkDestroyDescriptorSetLayout(p_app->device.logical, p_app->oit.composite.descriptor_set_layout, NULL);
+	p_app->oit.composite.descriptor_set_layout = VK_NULL_HANDLE;
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
 		vmaDestroyBuffer(p_app->mem.alloc, p_app->uniform.buffers[i], p_app->uniform.buffer_allocations[i]);
 	}
 	free(p_app->uniform.buffers);
@@ -122,73 +171,52 @@ void clean(_app *p_app) {
 	free(p_app->uniform.buffers_mapped);
 	p_app->uniform.buffers_mapped = NULL;
 
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vmaDestroyBuffer(
-			p_app->mem.alloc,
-			p_app->storage.billboard_buffers[i],
-			p_app->storage.billboard_buffer_allocations[i]
-		);
-	}
+	destroy_deletion_queues(p_app);
+	destroy_upload(p_app);
 
-	free(p_app->storage.billboard_buffers);
-	p_app->storage.billboard_buffers = NULL;
-	free(p_app->storage.billboard_buffer_allocations);
-	p_app->storage.billboard_buffer_allocations = NULL;
-	free(p_app->storage.billboard_buffers_mapped);
-	p_app->storage.billboard_buffers_mapped = NULL;
-
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vmaDestroyBuffer(
-			p_app->mem.alloc,
-			p_app->storage.solar_object_buffers[i],
-			p_app->storage.solar_object_buffer_allocations[i]
-		);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		destroy_mapped_buffer(p_app, &p_app->storage.billboards[i]);
+		destroy_mapped_buffer(p_app, &p_app->storage.solar_objects[i]);
+		destroy_mapped_buffer(p_app, &p_app->storage.instances[i]);
 	}
 
-	free(p_app->storage.solar_object_buffers);
-	p_app->storage.solar_object_buffers = NULL;
-	free(p_app->storage.solar_object_buffer_allocations);
-	p_app->storage.solar_object_buffer_allocations = NULL;
-	free(p_app->storage.solar_object_buffers_mapped);
-	p_app->storage.solar_object_buffers_mapped = NULL;
+	free(p_app->storage.billboards);
+	p_app->storage.billboards = NULL;
+	free(p_app->storage.solar_objects);
+	p_app->storage.solar_objects = NULL;
+	free(p_app->storage.instances);
+	p_app->storage.instances = NULL;
 
-	for (u32 i = 0; i < MESH_SPHERE_LOD_COUNT; i++) {
-		vmaDestroyBuffer(p_app->mem.alloc, p_app->mesh.index_buffers[i], p_app->mesh.index_allocations[i]);
-		vmaDestroyBuffer(p_app->mem.alloc, p_app->mesh.vertex_buffers[i], p_app->mesh.vertex_allocations[i]);
-	}
+	vmaDestroyBuffer(p_app->mem.alloc, p_app->mesh.index_buffer, p_app->mesh.index_allocation);
+	vmaDestroyBuffer(p_app->mem.alloc, p_app->mesh.vertex_buffer, p_app->mesh.vertex_allocation);
+	p_app->mesh.index_buffer = VK_NULL_HANDLE;
+	p_app->mesh.vertex_buffer = VK_NULL_HANDLE;
 
-	free(p_app->mesh.index_buffers);
-	p_app->mesh.index_buffers = NULL;
-	free(p_app->mesh.index_allocations);
-	p_app->mesh.index_allocations = NULL;
-	free(p_app->mesh.vertex_buffers);
-	p_app->mesh.vertex_buffers = NULL;
-	free(p_app->mesh.vertex_allocations);
-	p_app->mesh.vertex_allocations = NULL;
+	free(p_app->mesh.ranges);
+	p_app->mesh.ranges = NULL;
 
-	vmaDestroyBuffer(p_app->mem.alloc, p_app->billboard.instance_buffer, p_app->billboard.instance_allocation);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		destroy_mapped_buffer(p_app, &p_app->billboard.instances[i]);
+	}
+	free(p_app->billboard.instances);
+	p_app->billboard.instances = NULL;
 
 	vmaDestroyBuffer(p_app->mem.alloc, p_app->grid.vertex_buffer, p_app->grid.vertex_allocation);
 
+	destroy_cull(p_app);
+	destroy_visibility(p_app);
+	destroy_aggregates(p_app);
+	destroy_bvh(p_app);
+
 	free(p_app->cmd.buffers);
 	p_app->cmd.buffers = NULL;
 
-	for (u32 i = 0; i < p_app->swp.images_count; i++) {
-		vkDestroySemaphore(p_app->device.logical, p_app->sync.image_available_semaphores[i], NULL);
-		vkDestroySemaphore(p_app->device.logical, p_app->sync.render_finished_semaphores[i], NULL);
-	}
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vkDestroyFence(p_app->device.logical, p_app->sync.in_flight_fences[i], NULL);
-	}
-	free(p_app->sync.image_available_semaphores);
-	p_app->sync.image_available_semaphores = NULL;
-	free(p_app->sync.render_finished_semaphores);
-	p_app->sync.render_finished_semaphores = NULL;
-	free(p_app->sync.in_flight_fences);
-	p_app->sync.in_flight_fences = NULL;
+	destroy_sync_objects(p_app);
 
 	vkDestroyCommandPool(p_app->device.logical, p_app->cmd.pool, NULL);
 	p_app->cmd.pool = VK_NULL_HANDLE;
+	destroy_record_pools(p_app);
+	destroy_workers(p_app);
 
 	for (u32 i = 0; i < p_app->swp.images_count; i++) {
 		vkDestroyFramebuffer(p_app->device.logical, p_app->pipeline.swapchain_framebuffers[i], NULL);
@@ -200,19 +228,26 @@ void clean(_app *p_app) {
 
 	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.opaque, NULL);
 	p_app->pipeline.opaque = VK_NULL_HANDLE;
+	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.impostor, NULL);
+	p_app->pipeline.impostor = VK_NULL_HANDLE;
 	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.transparent, NULL);
 	p_app->pipeline.transparent = VK_NULL_HANDLE;
-	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.billboard, NULL);
-	p_app->pipeline.billboard = VK_NULL_HANDLE;
 	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.grid, NULL);
 	p_app->pipeline.grid = VK_NULL_HANDLE;
+	vkDestroyPipeline(p_app->device.logical, p_app->pipeline.point, NULL);
+	p_app->pipeline.point = VK_NULL_HANDLE;
 	vkDestroyPipelineLayout(p_app->device.logical, p_app->pipeline.layout, NULL);
 	p_app->pipeline.layout = VK_NULL_HANDLE;
+	vkDestroyPipeline(p_app->device.logical, p_app->oit.composite.pipeline, NULL);
+	p_app->oit.composite.pipeline = VK_NULL_HANDLE;
+	vkDestroyPipelineLayout(p_app->device.logical, p_app->oit.composite.layout, NULL);
+	p_app->oit.composite.layout = VK_NULL_HANDLE;
 	vkDestroyRenderPass(p_app->device.logical, p_app->pipeline.render_pass, NULL);
 	p_app->pipeline.render_pass = VK_NULL_HANDLE;
 
-	vkDestroyPipeline(p_app->device.logical, p_app->lens.pass.pipeline, NULL);
-	p_app->lens.pass.pipeline = VK_NULL_HANDLE;
+	destroy_lens_pipelines(p_app);
+	save_pipeline_cache(p_app);
+	destroy_pipeline_cache(p_app);
 	vkDestroyPipelineLayout(p_app->device.logical, p_app->lens.pass.layout, NULL);
 	p_app->lens.pass.layout = VK_NULL_HANDLE;
 	vkDestroySampler(p_app->device.logical, p_app->lens.target.sampler, NULL);
@@ -43,3 +43,14 @@ void set_colour(_solar_object *obj) {
 		obj->colour_id = planet_colour(obj->planet_type);
 	}
 }
+
+// the same view and projection the ubo is filled with, shared with the
+// cpu frustum cull so both agree on what is on screen
+void camera_matrices(_app *p_app, mat4 view, mat4 proj) {
+	glm_lookat(p_app->view.camera_pos, p_app->view.target, p_app->view.world_up, view);
+
+	float aspect = (float)p_app->swp.extent.width / (float)p_app->swp.extent.height;
+	glm_perspective(glm_rad(p_app->view.fov_y), aspect,
+								 p_app->view.near_plane, p_app->view.far_plane, proj);
+	proj[1][1] *= -1;
+}
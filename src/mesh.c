@@ -0,0 +1,206 @@
+#include "headers/mesh.h"
+
+// round to nearest even, overflow goes to infinity and anything below the
+// smallest normal is flushed, mesh attributes never need subnormals
+u16 float_to_half(float value) {
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	u32 sign = (bits >> 16) & 0x8000;
+	i32 exponent = (i32)((bits >> 23) & 0xFF) - 127 + 15;
+	u32 mantissa = bits & 0x7FFFFF;
+
+	if (exponent >= 31) return (u16)(sign | 0x7C00);
+	if (exponent <= 0) return (u16)sign;
+
+	u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+	u32 rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+	return (u16)half;
+}
+
+i16 float_to_snorm16(float value) {
+	if (value > 1.0f) value = 1.0f;
+	if (value < -1.0f) value = -1.0f;
+	return (i16)lrintf(value * 32767.0f);
+}
+
+// positions are snorm16 inside the unit cube, mesh.vert scales them by the
+// lod radius modifier. normals are folded onto an octahedron so two snorm16
+// hold a unit vector, uvs are halves
+void pack_vertex(const float pos[3], const float uv[2], const float norm[3], _vertex *p_vertex) {
+	p_vertex->pos[0] = float_to_snorm16(pos[0]);
+	p_vertex->pos[1] = float_to_snorm16(pos[1]);
+	p_vertex->pos[2] = float_to_snorm16(pos[2]);
+	p_vertex->pos[3] = 0;
+
+	p_vertex->uv[0] = float_to_half(uv[0]);
+	p_vertex->uv[1] = float_to_half(uv[1]);
+
+	float l1 = fabsf(norm[0]) + fabsf(norm[1]) + fabsf(norm[2]);
+	float ox = l1 > 0.0f ? norm[0] / l1 : 0.0f;
+	float oy = l1 > 0.0f ? norm[1] / l1 : 0.0f;
+	if (norm[2] < 0.0f) {
+		float fx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+		ox = fx;
+		oy = fy;
+	}
+	p_vertex->norm[0] = float_to_snorm16(ox);
+	p_vertex->norm[1] = float_to_snorm16(oy);
+}
+
+// tipsify (sander, nehab and barczak 2007). triangles are fanned around the
+// last vertex while it is still likely to sit in the post transform cache,
+// the next fan is picked from the vertices just emitted and a dead end
+// falls back to recently used vertices, then to the input order
+static i32 next_fanning_vertex(const u32 *live, const u32 *cache_time, u32 time, u32 cache_size,
+															 const u32 *candidates, u32 candidate_count,
+															 const u32 *dead_ends, u32 *dead_end_count,
+															 u32 *cursor, u32 vertex_count) {
+	i32 best = -1;
+	i32 best_priority = -1;
+
+	for (u32 c = 0; c < candidate_count; c++) {
+		u32 v = candidates[c];
+		if (live[v] == 0) continue;
+
+		i32 priority = 0;
+		if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = (i32)(time - cache_time[v]);
+		if (priority > best_priority) {
+			best_priority = priority;
+			best = (i32)v;
+		}
+	}
+	if (best >= 0) return best;
+
+	while (*dead_end_count > 0) {
+		u32 v = dead_ends[--(*dead_end_count)];
+		if (live[v] > 0) return (i32)v;
+	}
+
+	while (*cursor < vertex_count) {
+		u32 v = (*cursor)++;
+		if (live[v] > 0) return (i32)v;
+	}
+
+	return -1;
+}
+
+void optimize_vertex_cache(u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size) {
+	u32 triangle_count = index_count / 3;
+	if (triangle_count == 0 || vertex_count == 0) return;
+
+	u32 *live = calloc(vertex_count, sizeof(u32));
+	u32 *offsets = calloc(vertex_count + 1, sizeof(u32));
+	u32 *adjacency = malloc(sizeof(u32) * index_count);
+	u32 *cache_time = calloc(vertex_count, sizeof(u32));
+	u32 *dead_ends = malloc(sizeof(u32) * index_count);
+	bool *emitted = calloc(triangle_count, sizeof(bool));
+	u32 *output = malloc(sizeof(u32) * index_count);
+
+	for (u32 i = 0; i < index_count; i++) live[indices[i]]++;
+
+	u32 max_valence = 0;
+	for (u32 v = 0; v < vertex_count; v++) {
+		offsets[v + 1] = offsets[v] + live[v];
+		if (live[v] > max_valence) max_valence = live[v];
+	}
+
+	u32 *fill = malloc(sizeof(u32) * vertex_count);
+	memcpy(fill, offsets, sizeof(u32) * vertex_count);
+	for (u32 i = 0; i < index_count; i++) adjacency[fill[indices[i]]++] = i / 3;
+	free(fill);
+
+	u32 *candidates = malloc(sizeof(u32) * max_valence * 3);
+
+	u32 time = cache_size + 1;
+	u32 cursor = 1;
+	u32 dead_end_count = 0;
+	u32 written = 0;
+	i32 fanning = 0;
+
+	while (fanning >= 0) {
+		u32 f = (u32)fanning;
+		u32 candidate_count = 0;
+
+		for (u32 a = offsets[f]; a < offsets[f + 1]; a++) {
+			u32 t = adjacency[a];
+			if (emitted[t]) continue;
+			emitted[t] = true;
+
+			for (u32 k = 0; k < 3; k++) {
+				u32 v = indices[t * 3 + k];
+				output[written++] = v;
+				dead_ends[dead_end_count++] = v;
+				candidates[candidate_count++] = v;
+				live[v]--;
+				if (time - cache_time[v] > cache_size) {
+					cache_time[v] = time;
+					time++;
+				}
+			}
+		}
+
+		fanning = next_fanning_vertex(live, cache_time, time, cache_size,
+																 candidates, candidate_count,
+																 dead_ends, &dead_end_count,
+																 &cursor, vertex_count);
+	}
+
+	memcpy(indices, output, sizeof(u32) * written);
+
+	free(live);
+	free(offsets);
+	free(adjacency);
+	free(cache_time);
+	free(dead_ends);
+	free(emitted);
+	free(output);
+	free(candidates);
+}
+
+// renumbers vertices in the order the index list first touches them so
+// fetches walk the vertex buffer forwards, unreferenced vertices are
+// dropped. returns the new vertex count
+u32 optimize_vertex_fetch(_vertex *vertices, u32 *indices, u32 index_count, u32 vertex_count) {
+	u32 *remap = malloc(sizeof(u32) * vertex_count);
+	memset(remap, 0xFF, sizeof(u32) * vertex_count);
+	_vertex *reordered = malloc(sizeof(_vertex) * vertex_count);
+
+	u32 next = 0;
+	for (u32 i = 0; i < index_count; i++) {
+		u32 v = indices[i];
+		if (remap[v] == UINT32_MAX) {
+			remap[v] = next;
+			reordered[next++] = vertices[v];
+		}
+		indices[i] = remap[v];
+	}
+
+	memcpy(vertices, reordered, sizeof(_vertex) * next);
+	free(remap);
+	free(reordered);
+	return next;
+}
+
+// transformed vertices per triangle against a fifo cache, 0.5 is the floor
+// for a closed mesh and 3 means no reuse at all
+float average_cache_miss_ratio(const u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size) {
+	if (index_count < 3) return 0.0f;
+
+	u32 *stamp = calloc(vertex_count, sizeof(u32));
+	u32 clock = cache_size + 1;
+	u32 misses = 0;
+
+	for (u32 i = 0; i < index_count; i++) {
+		u32 v = indices[i];
+		if (clock - stamp[v] > cache_size) {
+			stamp[v] = clock++;
+			misses++;
+		}
+	}
+
+	free(stamp);
+	return (float)misses / (float)(index_count / 3);
+}
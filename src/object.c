@@ -1,4 +1,5 @@
 #include "headers/object.h"
+#include "headers/mesh.h"
 
 void generate_sphere(_app *p_app, u32 segments, u32 rings, _vertex **out_vertices, u32 *out_vcount, u32 **out_indices, u32 *out_icount) {
 	u32 vcount = (rings + 1) * (segments + 1);
@@ -20,21 +21,9 @@ void generate_sphere(_app *p_app, u32 segments, u32 rings, _vertex **out_vertice
 			float sy = cosf(phi);
 			float sz = sinf(phi) * sinf(theta);
 
-			verts[v].pos[0] = sx * p_app->config.lod.MESH_SPHERE_LOD_RADIUS_MODIFIER;
-			verts[v].pos[1] = sy * p_app->config.lod.MESH_SPHERE_LOD_RADIUS_MODIFIER;
-			verts[v].pos[2] = sz * p_app->config.lod.MESH_SPHERE_LOD_RADIUS_MODIFIER;
-
-			verts[v].norm[0] = sx;
-			verts[v].norm[1] = sy;
-			verts[v].norm[2] = sz;
-
-			verts[v].uv[0] = ucoord;
-			verts[v].uv[1] = vcoord;
-
-			verts[v].data[0] = 0xFFFFFF;
-			verts[v].data[1] = 0;
-			verts[v].data[2] = 0;
-			verts[v].data[3] = 0;
+			float dir[3] = {sx, sy, sz};
+			float uv[2] = {ucoord, vcoord};
+			pack_vertex(dir, uv, dir, &verts[v]);
 
 			v++;
 		}
@@ -64,19 +53,39 @@ void generate_sphere(_app *p_app, u32 segments, u32 rings, _vertex **out_vertice
 	*out_icount = icount;
 }
 
-void create_spheres(_app *p_app) {
-	u32 sphere_lods = MESH_SPHERE_LOD_COUNT;
-	u32 base = MESH_SHAPE_SPHERE_LOD0;
+// a unit quad facing +z, impostor.vert turns it to the camera
+static void generate_impostor_quad(_vertex **out_vertices, u32 *out_vcount, u32 **out_indices, u32 *out_icount) {
+	_vertex *verts = malloc(sizeof(_vertex) * 4);
+	u32 *inds = malloc(sizeof(u32) * 6);
+
+	float corners[4][2] = { {-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f} };
+	float norm[3] = {0.0f, 0.0f, 1.0f};
+	for (u32 v = 0; v < 4; v++) {
+		float pos[3] = {corners[v][0], corners[v][1], 0.0f};
+		float uv[2] = {corners[v][0] * 0.5f + 0.5f, corners[v][1] * 0.5f + 0.5f};
+		pack_vertex(pos, uv, norm, &verts[v]);
+	}
+
+	u32 quad[6] = {0, 1, 2, 0, 2, 3};
+	memcpy(inds, quad, sizeof(quad));
+
+	*out_vertices = verts;
+	*out_vcount = 4;
+	*out_indices = inds;
+	*out_icount = 6;
+}
 
-	p_app->mesh.vertex_counts = malloc(sizeof(u32) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.index_counts = malloc(sizeof(u32) * MESH_SPHERE_LOD_COUNT);
+// the sphere lods fill the start of the mesh table and the impostor quad
+// follows them, so mesh.impostor is also the number of sphere lods
+void create_spheres(_app *p_app) {
+	u32 sphere_lods = p_app->config.lod.count;
+	if (sphere_lods > MESH_SPHERE_LOD_MAX) sphere_lods = MESH_SPHERE_LOD_MAX;
+	p_app->mesh.impostor = sphere_lods;
+	p_app->mesh.count = sphere_lods + 1;
 
-	p_app->mesh.vertices = malloc(sizeof(_vertex*) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.indices = malloc(sizeof(u32*) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.vertex_allocations = malloc(sizeof(VmaAllocation) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.index_allocations = malloc(sizeof(VmaAllocation) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.vertex_buffers = malloc(sizeof(VkBuffer) * MESH_SPHERE_LOD_COUNT);
-	p_app->mesh.index_buffers = malloc(sizeof(VkBuffer) * MESH_SPHERE_LOD_COUNT);
+	p_app->mesh.ranges = calloc(p_app->mesh.count, sizeof(_mesh_range));
+	p_app->mesh.vertices = malloc(sizeof(_vertex*) * p_app->mesh.count);
+	p_app->mesh.indices = malloc(sizeof(u32*) * p_app->mesh.count);
 
 	for (u32 lod = 0; lod < sphere_lods; lod++) {
 		_vertex *verts;
@@ -93,17 +102,37 @@ void create_spheres(_app *p_app) {
 			&icount
 		);
 
-		u32 id = base + lod;
+		// the generated grid order reuses almost nothing from the post
+		// transform cache, reorder for it and then for fetch locality
+		float acmr_before = average_cache_miss_ratio(inds, icount, vcount, MESH_VERTEX_CACHE_SIZE);
+		optimize_vertex_cache(inds, icount, vcount, MESH_VERTEX_CACHE_SIZE);
+		vcount = optimize_vertex_fetch(verts, inds, icount, vcount);
+
+		if (p_app->config.win.flags & CONFIG_FLAG_PRINT_FPS) {
+			printf("[perf] sphere lod %u: %u verts, %u tris, acmr %.3f -> %.3f\n",
+					lod, vcount, icount / 3, acmr_before,
+					average_cache_miss_ratio(inds, icount, vcount, MESH_VERTEX_CACHE_SIZE));
+		}
 
-		p_app->mesh.vertex_counts[id] = vcount;
-		p_app->mesh.index_counts[id]  = icount;
+		p_app->mesh.ranges[lod].vertex_count = vcount;
+		p_app->mesh.ranges[lod].index_count  = icount;
 
-		p_app->mesh.vertices[id] = verts;
-		p_app->mesh.indices[id]  = inds;
+		p_app->mesh.vertices[lod] = verts;
+		p_app->mesh.indices[lod]  = inds;
 	}
+
+	_vertex *quad_verts;
+	u32 *quad_inds;
+	u32 quad_vcount, quad_icount;
+	generate_impostor_quad(&quad_verts, &quad_vcount, &quad_inds, &quad_icount);
+
+	p_app->mesh.ranges[p_app->mesh.impostor].vertex_count = quad_vcount;
+	p_app->mesh.ranges[p_app->mesh.impostor].index_count = quad_icount;
+	p_app->mesh.vertices[p_app->mesh.impostor] = quad_verts;
+	p_app->mesh.indices[p_app->mesh.impostor] = quad_inds;
 }
 
-_billboard generate_billboard(_solar_object *solar_object) {
+_billboard generate_billboard(_solar_object *solar_object, u32 object_index) {
 	_billboard billboard = {
 		.light_pos_w = {
 			.position = {
@@ -124,7 +153,7 @@ _billboard generate_billboard(_solar_object *solar_object) {
 		.type = BILLBOARD_TYPE_LIGHT,
 		.shape = BILLBOARD_SHAPE_CIRCLE,
 		.location = BILLBOARD_LOCATION_IN_WORLD,
-		.reserved = 0,
+		.object_index = object_index,
 	};
 
 	return billboard;
@@ -258,10 +287,12 @@ void create_billboards(_app *p_app) {
 			p_app->obj.billboard_max = 2 * p_app->obj.billboard_count;
 		}
 
-		p_app->obj.billboards[billboard_index] = generate_billboard(&p_app->obj.solar_objects[i]);
+		p_app->obj.billboards[billboard_index] = generate_billboard(&p_app->obj.solar_objects[i], i);
 		p_app->obj.solar_objects[i].billboard_index = billboard_index;
 		billboard_index++;
 	}
+
+	p_app->obj.billboard_dirty_frames = p_app->sync.frames_in_flight;
 }
 
 void calculate_gravity(_app *p_app) {
@@ -313,18 +344,3 @@ void calculate_gravity(_app *p_app) {
 		glm_vec3_add(obj->position, position_delta, obj->position);
 	}
 }
-
-void update_billboard_positions(_app *p_app) {
-	if (p_app->obj.billboard_count > 0) {
-		for (u32 i = 0; i < p_app->obj.solar_object_count; i++) {
-			_solar_object *solar_obj = &p_app->obj.solar_objects[i];
-			u32 b = solar_obj->billboard_index;
-
-			if (b < p_app->obj.billboard_count) {
-				p_app->obj.billboards[b].light_pos_w.position[0] = solar_obj->position[0];
-				p_app->obj.billboards[b].light_pos_w.position[1] = solar_obj->position[1];
-				p_app->obj.billboards[b].light_pos_w.position[2] = solar_obj->position[2];
-			}
-		}
-	}
-}
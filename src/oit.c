@@ -0,0 +1,258 @@
+#include "headers/oit.h"
+#include "headers/validation.h"
+#include "headers/swapchain.h"
+#include "headers/image.h"
+#include "headers/pipeline.h"
+#include "headers/deletion.h"
+
+// weighted blended transparency, subpass 1 accumulates premultiplied colour
+// and revealage in any order and subpass 2 composites them over the opaque
+// colour before it resolves
+
+void create_oit_resources(_app *p_app) {
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	create_image(p_app, &p_app->oit.accum.image, 1, p_app->device.msaa_samples, &p_app->oit.accum.image_allocation, p_app->swp.render_extent.width, p_app->swp.render_extent.height, OIT_ACCUM_FORMAT, VK_IMAGE_TILING_OPTIMAL, usage, VMA_MEMORY_USAGE_GPU_ONLY);
+	create_image_view(p_app, p_app->oit.accum.image, &p_app->oit.accum.image_view, 1, OIT_ACCUM_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	create_image(p_app, &p_app->oit.revealage.image, 1, p_app->device.msaa_samples, &p_app->oit.revealage.image_allocation, p_app->swp.render_extent.width, p_app->swp.render_extent.height, OIT_REVEALAGE_FORMAT, VK_IMAGE_TILING_OPTIMAL, usage, VMA_MEMORY_USAGE_GPU_ONLY);
+	create_image_view(p_app, p_app->oit.revealage.image, &p_app->oit.revealage.image_view, 1, OIT_REVEALAGE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void create_oit_descriptor_set_layout(_app *p_app) {
+	VkDescriptorSetLayoutBinding bindings[] = {
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		},
+	};
+
+	VkDescriptorSetLayoutCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+		.pBindings = bindings,
+	};
+
+	if (vkCreateDescriptorSetLayout(p_app->device.logical, &info, NULL, &p_app->oit.composite.descriptor_set_layout) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "oit descriptor set layout => failed to create");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void create_oit_descriptor_pool(_app *p_app) {
+	VkDescriptorPoolSize size = {
+		.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+		.descriptorCount = 2 * p_app->sync.frames_in_flight,
+	};
+
+	VkDescriptorPoolCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.poolSizeCount = 1,
+		.pPoolSizes = &size,
+		.maxSets = p_app->sync.frames_in_flight,
+	};
+
+	if (vkCreateDescriptorPool(p_app->device.logical, &info, NULL, &p_app->oit.descriptor.pool) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "oit descriptor pool => failed to create");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// the attachments are shared by every frame in flight like the colour and
+// depth targets, but each slot has its own set so a resize can repoint one
+// slot while the others are still in flight
+void write_oit_descriptor_set(_app *p_app, u32 frame_index) {
+	VkDescriptorImageInfo accum_info = {
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.imageView = p_app->oit.accum.image_view,
+	};
+	VkDescriptorImageInfo revealage_info = {
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.imageView = p_app->oit.revealage.image_view,
+	};
+
+	VkWriteDescriptorSet writes[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->oit.descriptor.sets[frame_index],
+			.dstBinding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+			.descriptorCount = 1,
+			.pImageInfo = &accum_info,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = p_app->oit.descriptor.sets[frame_index],
+			.dstBinding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+			.descriptorCount = 1,
+			.pImageInfo = &revealage_info,
+		},
+	};
+
+	vkUpdateDescriptorSets(p_app->device.logical, sizeof(writes) / sizeof(writes[0]), writes, 0, NULL);
+}
+
+void create_oit_descriptor_sets(_app *p_app) {
+	VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * p_app->sync.frames_in_flight);
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		layouts[i] = p_app->oit.composite.descriptor_set_layout;
+	}
+	p_app->oit.descriptor.sets = malloc(sizeof(VkDescriptorSet) * p_app->sync.frames_in_flight);
+
+	VkDescriptorSetAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = p_app->oit.descriptor.pool,
+		.descriptorSetCount = p_app->sync.frames_in_flight,
+		.pSetLayouts = layouts,
+	};
+
+	if (vkAllocateDescriptorSets(p_app->device.logical, &alloc_info, p_app->oit.descriptor.sets) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "oit descriptor sets => failed to allocate");
+		exit(EXIT_FAILURE);
+	}
+	free(layouts);
+
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		write_oit_descriptor_set(p_app, i);
+	}
+}
+
+void create_oit_pipeline(_app *p_app) {
+	VkShaderModule vert = create_shader_module(p_app, p_app->shader.lens_vert);
+	VkShaderModule frag = create_shader_module(p_app, p_app->shader.composite_frag);
+
+	// the composite averages every sample of the multisampled inputs
+	i32 sample_count = (i32)p_app->device.msaa_samples;
+	VkSpecializationMapEntry sample_count_entry = {
+		.constantID = 0,
+		.offset = 0,
+		.size = sizeof(i32),
+	};
+	VkSpecializationInfo specialization = {
+		.mapEntryCount = 1,
+		.pMapEntries = &sample_count_entry,
+		.dataSize = sizeof(i32),
+		.pData = &sample_count,
+	};
+
+	// the lens pass's fullscreen triangle is reused for the composite
+	VkPipelineShaderStageCreateInfo stages[2] = {
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = vert, .pName = "main" },
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = frag, .pName = "main", .pSpecializationInfo = &specialization },
+	};
+
+	VkPipelineVertexInputStateCreateInfo vertex_input = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo input_asm = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	};
+
+	VkViewport viewport = {
+		.width = (float)p_app->swp.render_extent.width,
+		.height = (float)p_app->swp.render_extent.height,
+		.minDepth = 0.0f, .maxDepth = 1.0f,
+	};
+	VkRect2D scissor = { .extent = p_app->swp.render_extent };
+
+	VkPipelineViewportStateCreateInfo viewport_state = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1, .pViewports = &viewport,
+		.scissorCount = 1, .pScissors = &scissor,
+	};
+
+	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic_state = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamic_states,
+	};
+
+	VkPipelineRasterizationStateCreateInfo raster = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_NONE,
+		.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+		.lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisample = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = p_app->device.msaa_samples,
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depth = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+	};
+
+	// out alpha is 1 - revealage, the opaque colour shows through by revealage
+	VkPipelineColorBlendAttachmentState blend = {
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+		.blendEnable = VK_TRUE,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+	};
+	VkPipelineColorBlendStateCreateInfo blend_state = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.attachmentCount = 1,
+		.pAttachments = &blend,
+	};
+
+	VkPipelineLayoutCreateInfo layout_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &p_app->oit.composite.descriptor_set_layout,
+	};
+
+	if (vkCreatePipelineLayout(p_app->device.logical, &layout_info, NULL, &p_app->oit.composite.layout) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "oit pipeline layout => failed");
+		exit(EXIT_FAILURE);
+	}
+
+	VkGraphicsPipelineCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount = 2,
+		.pStages = stages,
+		.pVertexInputState = &vertex_input,
+		.pInputAssemblyState = &input_asm,
+		.pViewportState = &viewport_state,
+		.pRasterizationState = &raster,
+		.pMultisampleState = &multisample,
+		.pDepthStencilState = &depth,
+		.pColorBlendState = &blend_state,
+		.pDynamicState = &dynamic_state,
+		.layout = p_app->oit.composite.layout,
+		.renderPass = p_app->pipeline.render_pass,
+		.subpass = 2,
+	};
+
+	if (create_cached_graphics_pipeline(p_app, &info, &p_app->oit.composite.pipeline) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "oit composite pipeline => failed");
+		exit(EXIT_FAILURE);
+	}
+
+	vkDestroyShaderModule(p_app->device.logical, vert, NULL);
+	vkDestroyShaderModule(p_app->device.logical, frag, NULL);
+}
+
+// the old attachments go on this frame slot's deletion queue, the sets
+// that name them are rewritten per slot by refresh_target_descriptors
+void retire_oit_resources(_app *p_app, u32 frame_index) {
+	defer_image_destruction(p_app, frame_index, p_app->oit.accum.image, p_app->oit.accum.image_view, p_app->oit.accum.image_allocation);
+	defer_image_destruction(p_app, frame_index, p_app->oit.revealage.image, p_app->oit.revealage.image_view, p_app->oit.revealage.image_allocation);
+}
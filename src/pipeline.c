@@ -1,68 +1,250 @@
 #include "headers/pipeline.h"
 #include "headers/shader.h"
 #include "headers/validation.h"
+#include <sys/stat.h>
+
+// the header is the vendor, device and cache uuid the data was built for,
+// a driver update changes the uuid so a stale file is dropped rather than
+// handed to a driver that may reject or misuse it
+#define PIPELINE_CACHE_HEADER_SIZE (sizeof(u32) * 4 + VK_UUID_SIZE)
+
+static bool is_pipeline_cache_valid(const VkPhysicalDeviceProperties *properties, const u8 *data, size_t size) {
+	if (size < PIPELINE_CACHE_HEADER_SIZE) return false;
+
+	u32 header[4];
+	memcpy(header, data, sizeof(header));
+	u32 header_size = header[0];
+	u32 header_version = header[1];
+	u32 vendor_id = header[2];
+	u32 device_id = header[3];
+
+	if (header_size < PIPELINE_CACHE_HEADER_SIZE || header_size > size) return false;
+	if (header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+	if (vendor_id != properties->vendorID || device_id != properties->deviceID) return false;
+	return memcmp(data + sizeof(header), properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
 
-char* read_file(_app *p_app, const char* filename, size_t* shader_code_size) {
-	FILE* p_file = fopen(filename, "rb");
-	if (!p_file) {
+void create_pipeline_cache(_app *p_app) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(p_app->device.physical, &properties);
+
+	snprintf(p_app->pipeline.cache_path, sizeof(p_app->pipeline.cache_path), "%s/pipeline_%04x_%04x.bin",
+					p_app->config.cache.directory, properties.vendorID, properties.deviceID);
+
+	u8 *data = NULL;
+	size_t size = 0;
+
+	FILE *p_file = fopen(p_app->pipeline.cache_path, "rb");
+	if (p_file) {
+		fseek(p_file, 0, SEEK_END);
+		long file_size = ftell(p_file);
+		rewind(p_file);
+
+		if (file_size > 0) {
+			data = malloc(file_size);
+			size = fread(data, 1, file_size, p_file);
+		}
+		fclose(p_file);
+
+		if (data && !is_pipeline_cache_valid(&properties, data, size)) {
+			submit_debug_message(
+				p_app->inst.instance,
+				VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+				"pipeline cache => file does not match this device, starting cold"
+			);
+			free(data);
+			data = NULL;
+			size = 0;
+		}
+	}
+
+	VkPipelineCacheCreateInfo cache_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = size,
+		.pInitialData = data,
+	};
+
+	// a driver can still refuse data that passed the header check, an
+	// empty cache is always accepted
+	VkResult result = vkCreatePipelineCache(p_app->device.logical, &cache_info, NULL, &p_app->pipeline.cache);
+	if (result != VK_SUCCESS && data) {
+		cache_info.initialDataSize = 0;
+		cache_info.pInitialData = NULL;
+		free(data);
+		data = NULL;
+		result = vkCreatePipelineCache(p_app->device.logical, &cache_info, NULL, &p_app->pipeline.cache);
+	}
+
+	if (result != VK_SUCCESS) {
 		submit_debug_message(
 			p_app->inst.instance,
 			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-			"shader read => failed to open file"
+			"pipeline cache => failed to create pipeline cache"
 		);
-		return NULL;
+		exit(EXIT_FAILURE);
 	}
 
-	fseek(p_file, 0, SEEK_END);
-	long file_size = ftell(p_file);
-	rewind(p_file);
+	p_app->pipeline.cache_warm = data != NULL;
+	free(data);
+}
 
-	if (file_size <= 0) {
-		fclose(p_file);
+// written to a temporary file and renamed over the old one, so a crash
+// mid write never leaves a truncated cache behind
+void save_pipeline_cache(_app *p_app) {
+	size_t size = 0;
+	if (vkGetPipelineCacheData(p_app->device.logical, p_app->pipeline.cache, &size, NULL) != VK_SUCCESS || size == 0) return;
+
+	u8 *data = malloc(size);
+	if (vkGetPipelineCacheData(p_app->device.logical, p_app->pipeline.cache, &size, data) != VK_SUCCESS) {
+		free(data);
+		return;
+	}
+
+	mkdir(p_app->config.cache.directory, 0755);
+
+	char temp_path[sizeof(p_app->pipeline.cache_path) + 4];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", p_app->pipeline.cache_path);
+
+	FILE *p_file = fopen(temp_path, "wb");
+	if (!p_file) {
 		submit_debug_message(
 			p_app->inst.instance,
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-			"shader read => empty or invalid file"
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+			"pipeline cache => failed to open cache file for writing"
 		);
-		return NULL;
+		free(data);
+		return;
+	}
+
+	bool written = fwrite(data, 1, size, p_file) == size;
+	written = fclose(p_file) == 0 && written;
+	if (written) {
+		rename(temp_path, p_app->pipeline.cache_path);
+	} else {
+		remove(temp_path);
+	}
+	free(data);
+}
+
+void destroy_pipeline_cache(_app *p_app) {
+	vkDestroyPipelineCache(p_app->device.logical, p_app->pipeline.cache, NULL);
+	p_app->pipeline.cache = VK_NULL_HANDLE;
+}
+
+double elapsed_ms(const struct timespec *from) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) * 1e3 + (now.tv_nsec - from->tv_nsec) / 1e6;
+}
+
+// every pipeline goes through these so they all hit the cache and their
+// compile time adds up in perf.pipeline_ms
+VkResult create_cached_graphics_pipeline(_app *p_app, const VkGraphicsPipelineCreateInfo *info, VkPipeline *p_pipeline) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	VkResult result = vkCreateGraphicsPipelines(p_app->device.logical, p_app->pipeline.cache, 1, info, NULL, p_pipeline);
+	p_app->perf.pipeline_ms += elapsed_ms(&start);
+	return result;
+}
+
+VkResult create_cached_compute_pipeline(_app *p_app, const VkComputePipelineCreateInfo *info, VkPipeline *p_pipeline) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	VkResult result = vkCreateComputePipelines(p_app->device.logical, p_app->pipeline.cache, 1, info, NULL, p_pipeline);
+	p_app->perf.pipeline_ms += elapsed_ms(&start);
+	return result;
+}
+
+static void *compile_pipeline_job(void *p_arg) {
+	_pipeline_worker *worker = p_arg;
+	for (u32 i = worker->first; i < worker->count; i += worker->stride) {
+		_pipeline_job *job = &worker->jobs[i];
+		job->result = vkCreateGraphicsPipelines(worker->p_app->device.logical, worker->p_app->pipeline.cache, 1, job->info, NULL, job->p_pipeline);
 	}
+	return NULL;
+}
+
+// compiles independent pipelines across worker threads, the cache is
+// internally synchronised so they all share it. only the wall time lands in
+// perf.pipeline_ms, the calling thread takes the first stride
+void compile_pipelines(_app *p_app, _pipeline_job *jobs, u32 count) {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	u32 thread_count = cores > 1 ? (u32)cores : 1;
+	if (thread_count > PIPELINE_MAX_THREADS) thread_count = PIPELINE_MAX_THREADS;
+	if (thread_count > count) thread_count = count;
 
-	char* buffer = malloc(file_size);
+	_pipeline_worker workers[PIPELINE_MAX_THREADS];
+	pthread_t threads[PIPELINE_MAX_THREADS];
+	bool started[PIPELINE_MAX_THREADS] = {0};
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (u32 t = 0; t < thread_count; t++) {
+		workers[t] = (_pipeline_worker){ .p_app = p_app, .jobs = jobs, .count = count, .first = t, .stride = thread_count };
+	}
+
+	// a worker that fails to start has its jobs compiled inline instead
+	for (u32 t = 1; t < thread_count; t++) {
+		started[t] = pthread_create(&threads[t], NULL, compile_pipeline_job, &workers[t]) == 0;
+	}
+	compile_pipeline_job(&workers[0]);
+
+	for (u32 t = 1; t < thread_count; t++) {
+		if (started[t]) {
+			pthread_join(threads[t], NULL);
+		} else {
+			compile_pipeline_job(&workers[t]);
+		}
+	}
 
-	fread(buffer, 1, file_size, p_file);
-	fclose(p_file);
+	p_app->perf.pipeline_ms += elapsed_ms(&start);
 
-	*shader_code_size = (size_t)file_size;
-	return buffer;
+	for (u32 i = 0; i < count; i++) {
+		if (jobs[i].result != VK_SUCCESS) {
+			submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "%s pipeline => failed", jobs[i].name);
+			exit(EXIT_FAILURE);
+		}
+	}
 }
 
 void create_graphics_pipelines(_app *p_app) {
-	size_t mesh_vert_shader_code_size;
-	size_t mesh_frag_shader_code_size;
-	size_t billboard_vert_shader_code_size;
-	size_t billboard_frag_shader_code_size;
-	size_t grid_vert_shader_code_size;
-	size_t grid_frag_shader_code_size;
-
-	const char* mesh_vert_shader_code = read_file(p_app, p_app->shader.mesh_vert, &mesh_vert_shader_code_size);
-	const char* mesh_frag_shader_code = read_file(p_app, p_app->shader.mesh_frag, &mesh_frag_shader_code_size);
-	const char* billboard_vert_shader_code = read_file(p_app, p_app->shader.billboard_vert, &billboard_vert_shader_code_size);
-	const char* billboard_frag_shader_code = read_file(p_app, p_app->shader.billboard_frag, &billboard_frag_shader_code_size);
-	const char* grid_vert_shader_code = read_file(p_app, p_app->shader.grid_vert, &grid_vert_shader_code_size);
-	const char* grid_frag_shader_code = read_file(p_app, p_app->shader.grid_frag, &grid_frag_shader_code_size);
-
-	VkShaderModule mesh_vert_shader_module = create_shader_module(p_app, mesh_vert_shader_code, mesh_vert_shader_code_size); 
-	VkShaderModule mesh_frag_shader_module = create_shader_module(p_app, mesh_frag_shader_code, mesh_frag_shader_code_size);
-	VkShaderModule billboard_vert_shader_module = create_shader_module(p_app, billboard_vert_shader_code, billboard_vert_shader_code_size); 
-	VkShaderModule billboard_frag_shader_module = create_shader_module(p_app, billboard_frag_shader_code, billboard_frag_shader_code_size);
-	VkShaderModule grid_vert_shader_module = create_shader_module(p_app, grid_vert_shader_code, grid_vert_shader_code_size); 
-	VkShaderModule grid_frag_shader_module = create_shader_module(p_app, grid_frag_shader_code, grid_frag_shader_code_size);
+	VkShaderModule mesh_vert_shader_module = create_shader_module(p_app, p_app->shader.mesh_vert);
+	VkShaderModule mesh_frag_shader_module = create_shader_module(p_app, p_app->shader.mesh_frag);
+	VkShaderModule billboard_vert_shader_module = create_shader_module(p_app, p_app->shader.billboard_vert);
+	VkShaderModule billboard_frag_shader_module = create_shader_module(p_app, p_app->shader.billboard_frag);
+	VkShaderModule grid_vert_shader_module = create_shader_module(p_app, p_app->shader.grid_vert);
+	VkShaderModule grid_frag_shader_module = create_shader_module(p_app, p_app->shader.grid_frag);
+	VkShaderModule point_vert_shader_module = create_shader_module(p_app, p_app->shader.point_vert);
+	VkShaderModule point_frag_shader_module = create_shader_module(p_app, p_app->shader.point_frag);
+	VkShaderModule impostor_vert_shader_module = create_shader_module(p_app, p_app->shader.impostor_vert);
+	VkShaderModule impostor_frag_shader_module = create_shader_module(p_app, p_app->shader.impostor_frag);
+
+	// mesh positions are quantised to the unit cube, the radius modifier is
+	// a constant of the mesh vertex shader
+	float radius_modifier = p_app->config.lod.MESH_SPHERE_LOD_RADIUS_MODIFIER;
+	VkSpecializationMapEntry radius_modifier_entry = {
+		.constantID = 0,
+		.offset = 0,
+		.size = sizeof(float),
+	};
+	VkSpecializationInfo mesh_vert_specialization = {
+		.mapEntryCount = 1,
+		.pMapEntries = &radius_modifier_entry,
+		.dataSize = sizeof(float),
+		.pData = &radius_modifier,
+	};
 
 	VkPipelineShaderStageCreateInfo mesh_shader_stages[2] = {
-		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = mesh_vert_shader_module, .pName = "main" },
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = mesh_vert_shader_module, .pName = "main", .pSpecializationInfo = &mesh_vert_specialization },
 		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = mesh_frag_shader_module, .pName = "main" },
 	};
 
+	VkPipelineShaderStageCreateInfo impostor_shader_stages[2] = {
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = impostor_vert_shader_module, .pName = "main", .pSpecializationInfo = &mesh_vert_specialization },
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = impostor_frag_shader_module, .pName = "main" },
+	};
+
 	VkPipelineShaderStageCreateInfo billboard_shader_stages[2] = {
 		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = billboard_vert_shader_module, .pName = "main" },
 		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = billboard_frag_shader_module, .pName = "main" },
@@ -73,6 +255,11 @@ void create_graphics_pipelines(_app *p_app) {
 		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = grid_frag_shader_module, .pName = "main" },
 	};
 
+	VkPipelineShaderStageCreateInfo point_shader_stages[2] = {
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = point_vert_shader_module, .pName = "main" },
+		{ .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = point_frag_shader_module, .pName = "main" },
+	};
+
 	VkVertexInputBindingDescription mesh_binding_desc = get_mesh_binding_description();
 	u32 mesh_attr_count = 0;
 	get_mesh_attribute_descriptions(NULL, &mesh_attr_count);
@@ -115,6 +302,10 @@ void create_graphics_pipelines(_app *p_app) {
 		.pVertexAttributeDescriptions = grid_attr_descs,
 	};
 
+	VkPipelineVertexInputStateCreateInfo point_vertex_input = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+	};
+
 	VkPipelineInputAssemblyStateCreateInfo input_asm = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
 		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -125,6 +316,11 @@ void create_graphics_pipelines(_app *p_app) {
 		.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
 	};
 
+	VkPipelineInputAssemblyStateCreateInfo input_asm_point = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
+	};
+
 	VkViewport viewport = {
 		.width = p_app->swp.render_extent.width,
 		.height = p_app->swp.render_extent.height,
@@ -175,18 +371,32 @@ void create_graphics_pipelines(_app *p_app) {
 		.blendEnable = VK_FALSE
 	};
 
-	VkPipelineColorBlendAttachmentState blend_transparent = {
-		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-		.blendEnable = VK_TRUE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-		.colorBlendOp = VK_BLEND_OP_ADD,
-		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-		.alphaBlendOp = VK_BLEND_OP_ADD,
+	// accumulation adds premultiplied colour and weight, revealage multiplies
+	// by one minus each coverage
+	VkPipelineColorBlendAttachmentState blend_transparent[2] = {
+		{
+			.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+			.blendEnable = VK_TRUE,
+			.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+			.dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
+			.colorBlendOp = VK_BLEND_OP_ADD,
+			.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.alphaBlendOp = VK_BLEND_OP_ADD,
+		},
+		{
+			.colorWriteMask = VK_COLOR_COMPONENT_R_BIT,
+			.blendEnable = VK_TRUE,
+			.srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+			.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR,
+			.colorBlendOp = VK_BLEND_OP_ADD,
+			.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+			.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.alphaBlendOp = VK_BLEND_OP_ADD,
+		},
 	};
 
-	VkPipelineColorBlendAttachmentState blend_billboard = {
+	VkPipelineColorBlendAttachmentState blend_grid = {
 		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
 		.blendEnable = VK_TRUE,
 		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
@@ -197,14 +407,14 @@ void create_graphics_pipelines(_app *p_app) {
 		.alphaBlendOp = VK_BLEND_OP_ADD,
 	};
 
-	VkPipelineColorBlendAttachmentState blend_grid = {
+	VkPipelineColorBlendAttachmentState blend_point = {
 		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
 		.blendEnable = VK_TRUE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
 		.colorBlendOp = VK_BLEND_OP_ADD,
 		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
 		.alphaBlendOp = VK_BLEND_OP_ADD,
 	};
 
@@ -213,18 +423,10 @@ void create_graphics_pipelines(_app *p_app) {
 		.attachmentCount = 1,
 	};
 
-	VkPushConstantRange push_constant_range = {
-    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-    .offset = 0,
-    .size = sizeof(_push_constants),
-	};
-
 	VkPipelineLayoutCreateInfo layout_info = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 		.setLayoutCount = 1,
 		.pSetLayouts = &p_app->pipeline.descriptor_set_layout,
-    .pushConstantRangeCount = 1,
-    .pPushConstantRanges = &push_constant_range,
 	};
 
 	if (vkCreatePipelineLayout(p_app->device.logical, &layout_info, NULL, &p_app->pipeline.layout) != VK_SUCCESS) {
@@ -232,6 +434,24 @@ void create_graphics_pipelines(_app *p_app) {
 		exit(EXIT_FAILURE);
 	}
 
+	// every pipeline gets its own copy of the state it changes so they can
+	// all be compiled at once
+	VkPipelineDepthStencilStateCreateInfo depth_write = depth;
+	depth_write.depthWriteEnable = VK_TRUE;
+
+	VkPipelineRasterizationStateCreateInfo raster_no_cull = raster;
+	raster_no_cull.cullMode = VK_CULL_MODE_NONE;
+
+	VkPipelineColorBlendStateCreateInfo blend_state_opaque = blend_state;
+	blend_state_opaque.pAttachments = &blend_opaque;
+	VkPipelineColorBlendStateCreateInfo blend_state_transparent = blend_state;
+	blend_state_transparent.attachmentCount = 2;
+	blend_state_transparent.pAttachments = blend_transparent;
+	VkPipelineColorBlendStateCreateInfo blend_state_point = blend_state;
+	blend_state_point.pAttachments = &blend_point;
+	VkPipelineColorBlendStateCreateInfo blend_state_grid = blend_state;
+	blend_state_grid.pAttachments = &blend_grid;
+
 	VkGraphicsPipelineCreateInfo pipeline_info = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.stageCount = 2,
@@ -241,48 +461,51 @@ void create_graphics_pipelines(_app *p_app) {
 		.pMultisampleState = &multisample,
 		.pDepthStencilState = &depth,
 		.pDynamicState = &dynamic_state,
-		.pColorBlendState = &blend_state,
+		.pColorBlendState = &blend_state_opaque,
 		.layout = p_app->pipeline.layout,
 		.renderPass = p_app->pipeline.render_pass,
 	};
 
-	depth.depthWriteEnable = VK_TRUE;
-	blend_state.pAttachments = &blend_opaque;
-	pipeline_info.pStages = mesh_shader_stages;
-	pipeline_info.pVertexInputState = &mesh_vertex_input;
-	if (vkCreateGraphicsPipelines(p_app->device.logical, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &p_app->pipeline.opaque) != VK_SUCCESS) {
-		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "opaque pipeline => failed");
-		exit(EXIT_FAILURE);
-	}
-
-	depth.depthWriteEnable = VK_FALSE;
-	blend_state.pAttachments = &blend_transparent;
-	pipeline_info.pStages = mesh_shader_stages;
-	pipeline_info.pVertexInputState = &mesh_vertex_input;
-	if (vkCreateGraphicsPipelines(p_app->device.logical, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &p_app->pipeline.transparent) != VK_SUCCESS) {
-		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "transparent pipeline => failed");
-		exit(EXIT_FAILURE);
-	}
-
-	depth.depthWriteEnable = VK_FALSE;
-	blend_state.pAttachments = &blend_billboard;
-	pipeline_info.pStages = billboard_shader_stages;
-	pipeline_info.pVertexInputState = &billboard_vertex_input;
-	if (vkCreateGraphicsPipelines(p_app->device.logical, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &p_app->pipeline.billboard) != VK_SUCCESS) {
-		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "billboard pipeline => failed");
-		exit(EXIT_FAILURE);
-	}
-
-	depth.depthWriteEnable = VK_TRUE;
-	blend_state.pAttachments = &blend_grid;
-	pipeline_info.pStages = grid_shader_stages;
-	pipeline_info.pVertexInputState = &grid_vertex_input;
-	pipeline_info.pInputAssemblyState = &input_asm_grid;
-	raster.cullMode = VK_CULL_MODE_NONE;
-	if (vkCreateGraphicsPipelines(p_app->device.logical, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &p_app->pipeline.grid) != VK_SUCCESS) {
-		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "grid pipeline => failed");
-		exit(EXIT_FAILURE);
-	}
+	VkGraphicsPipelineCreateInfo opaque_info = pipeline_info;
+	opaque_info.pStages = mesh_shader_stages;
+	opaque_info.pVertexInputState = &mesh_vertex_input;
+	opaque_info.pDepthStencilState = &depth_write;
+
+	// impostors read the mesh table's quad and turn it to the camera, which
+	// way it winds depends on the view so nothing is culled
+	VkGraphicsPipelineCreateInfo impostor_info = opaque_info;
+	impostor_info.pStages = impostor_shader_stages;
+	impostor_info.pRasterizationState = &raster_no_cull;
+
+	// billboards accumulate into the oit attachments of subpass 1 unsorted
+	VkGraphicsPipelineCreateInfo transparent_info = pipeline_info;
+	transparent_info.pStages = billboard_shader_stages;
+	transparent_info.pVertexInputState = &billboard_vertex_input;
+	transparent_info.pColorBlendState = &blend_state_transparent;
+	transparent_info.subpass = 1;
+
+	VkGraphicsPipelineCreateInfo point_info = pipeline_info;
+	point_info.pStages = point_shader_stages;
+	point_info.pVertexInputState = &point_vertex_input;
+	point_info.pInputAssemblyState = &input_asm_point;
+	point_info.pColorBlendState = &blend_state_point;
+
+	VkGraphicsPipelineCreateInfo grid_info = pipeline_info;
+	grid_info.pStages = grid_shader_stages;
+	grid_info.pVertexInputState = &grid_vertex_input;
+	grid_info.pInputAssemblyState = &input_asm_grid;
+	grid_info.pRasterizationState = &raster_no_cull;
+	grid_info.pDepthStencilState = &depth_write;
+	grid_info.pColorBlendState = &blend_state_grid;
+
+	_pipeline_job jobs[] = {
+		{ .name = "opaque", .info = &opaque_info, .p_pipeline = &p_app->pipeline.opaque },
+		{ .name = "impostor", .info = &impostor_info, .p_pipeline = &p_app->pipeline.impostor },
+		{ .name = "transparent", .info = &transparent_info, .p_pipeline = &p_app->pipeline.transparent },
+		{ .name = "point", .info = &point_info, .p_pipeline = &p_app->pipeline.point },
+		{ .name = "grid", .info = &grid_info, .p_pipeline = &p_app->pipeline.grid },
+	};
+	compile_pipelines(p_app, jobs, sizeof(jobs) / sizeof(jobs[0]));
 
 	vkDestroyShaderModule(p_app->device.logical, mesh_frag_shader_module, NULL);
 	vkDestroyShaderModule(p_app->device.logical, mesh_vert_shader_module, NULL);
@@ -290,19 +513,17 @@ void create_graphics_pipelines(_app *p_app) {
 	vkDestroyShaderModule(p_app->device.logical, billboard_vert_shader_module, NULL);
 	vkDestroyShaderModule(p_app->device.logical, grid_frag_shader_module, NULL);
 	vkDestroyShaderModule(p_app->device.logical, grid_vert_shader_module, NULL);
-	free((void*)mesh_vert_shader_code);
-	free((void*)mesh_frag_shader_code);
-	free((void*)billboard_vert_shader_code);
-	free((void*)billboard_frag_shader_code);
-	free((void*)grid_vert_shader_code);
-	free((void*)grid_frag_shader_code);
+	vkDestroyShaderModule(p_app->device.logical, point_frag_shader_module, NULL);
+	vkDestroyShaderModule(p_app->device.logical, point_vert_shader_module, NULL);
+	vkDestroyShaderModule(p_app->device.logical, impostor_frag_shader_module, NULL);
+	vkDestroyShaderModule(p_app->device.logical, impostor_vert_shader_module, NULL);
 }
 
-VkShaderModule create_shader_module(_app *p_app, const char* shader_code, size_t shader_code_size) {
+VkShaderModule create_shader_module(_app *p_app, _shader_code shader_code) {
 	VkShaderModuleCreateInfo shader_module_create_info = {
 		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.codeSize = shader_code_size,
-		.pCode = (const uint32_t*) shader_code,
+		.codeSize = shader_code.size,
+		.pCode = shader_code.code,
 	};
 
 	VkShaderModule shader_module;
@@ -0,0 +1,496 @@
+#include "headers/record.h"
+#include "headers/validation.h"
+#include "headers/buffer.h"
+#include "headers/cull.h"
+#include "headers/render_queue.h"
+#include "headers/deletion.h"
+#include "headers/workers.h"
+
+// every dynamic pass is recorded into its own secondary buffer each frame,
+// each from a pool owned by that frame slot and pass. pools are externally
+// synchronised so giving every worker its own is what lets them record
+// without locking, the primary then only stitches them together
+void create_record_pools(_app *p_app) {
+	u32 count = p_app->sync.frames_in_flight * RECORD_PASS_COUNT;
+	p_app->cmd.worker_pools = malloc(sizeof(VkCommandPool) * count);
+
+	VkCommandPoolCreateInfo pool_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = p_app->device.queue_indices.graphics_family,
+	};
+
+	for (u32 i = 0; i < count; i++) {
+		if (vkCreateCommandPool(p_app->device.logical, &pool_info, NULL, &p_app->cmd.worker_pools[i]) != VK_SUCCESS) {
+			submit_debug_message(
+				p_app->inst.instance,
+				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+				"command pool => failed to create worker command pool"
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (u32 p = 0; p < RECORD_PASS_COUNT; p++) {
+		create_render_queue(&p_app->cmd.queues[p]);
+	}
+
+	p_app->cmd.fill = (_record_fill){0};
+}
+
+void create_secondary_command_buffers(_app *p_app) {
+	u32 count = p_app->sync.frames_in_flight * RECORD_PASS_COUNT;
+	p_app->cmd.secondaries = malloc(sizeof(VkCommandBuffer) * count);
+
+	for (u32 i = 0; i < count; i++) {
+		VkCommandBufferAllocateInfo alloc_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = p_app->cmd.worker_pools[i],
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1,
+		};
+
+		if (vkAllocateCommandBuffers(p_app->device.logical, &alloc_info, &p_app->cmd.secondaries[i]) != VK_SUCCESS) {
+			submit_debug_message(
+				p_app->inst.instance,
+				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+				"command buffer => failed to allocate secondary command buffer"
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+VkCommandBuffer get_secondary_command_buffer(_app *p_app, _record_pass pass) {
+	return p_app->cmd.secondaries[p_app->sync.frame_index * RECORD_PASS_COUNT + pass];
+}
+
+// dynamic state is not inherited by secondaries, each one sets its own
+static void set_render_area(_app *p_app, VkCommandBuffer command_buffer) {
+	VkViewport viewport = {
+		.x = 0.0f, .y = 0.0f,
+		.width = (float)p_app->swp.render_extent.width,
+		.height = (float)p_app->swp.render_extent.height,
+		.minDepth = 0.0f, .maxDepth = 1.0f
+	};
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+	VkRect2D scissor = { .offset = {0, 0}, .extent = p_app->swp.render_extent };
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
+
+static void record_opaque_pass(_app *p_app, _render_queue *queue) {
+	queue_culled_draws(p_app, queue);
+
+	if (p_app->visibility.point_count > 0) {
+		_draw_packet packet = {
+			.pipeline = p_app->pipeline.point,
+			.layout = p_app->pipeline.layout,
+			.material = p_app->descriptor.sets[p_app->sync.frame_index],
+			.first = p_app->visibility.point_first,
+			.count = p_app->visibility.point_count,
+			.instance_count = 1,
+		};
+		push_render_queue(queue, RECORD_PASS_OPAQUE, 0.0f, &packet);
+	}
+}
+
+// compacts one chunk of the visible bodies that have a billboard. a single
+// chunk writes straight into the ring, split ones into their own stretch
+// of scratch so the chunks never need to know each other's counts
+static void fill_billboard_chunk(_app *p_app, u32 chunk) {
+	_record_fill *fill = &p_app->cmd.fill;
+	u32 billboard_count = p_app->obj.billboard_count;
+	u32 *out = (fill->chunk_count == 1 ? fill->out : fill->scratch) + fill->firsts[chunk];
+	u32 count = 0;
+
+	for (u32 v = fill->firsts[chunk]; v < fill->firsts[chunk + 1]; ++v) {
+		_solar_object *obj = &p_app->obj.solar_objects[p_app->visibility.bodies[v]];
+		if (obj->billboard_index < billboard_count) out[count++] = obj->billboard_index;
+	}
+	fill->counts[chunk] = count;
+}
+
+static void copy_billboard_chunk(_app *p_app, u32 chunk) {
+	_record_fill *fill = &p_app->cmd.fill;
+	memcpy(fill->out + fill->offsets[chunk], fill->scratch + fill->firsts[chunk], sizeof(u32) * fill->counts[chunk]);
+}
+
+// only billboards of bodies that survived the frustum cull are drawn, the
+// impostors sit after the body billboards in the billboard sbo. this is the
+// only part of recording whose cpu cost grows with the scene, so it is
+// split across the workers before the passes, and the only one that
+// touches the frame's deletion queue so the grow stays on this thread
+static void fill_billboard_indices(_app *p_app, bool threaded) {
+	_record_fill *fill = &p_app->cmd.fill;
+	fill->draw_count = 0;
+
+	u32 billboard_count = p_app->obj.billboard_count;
+	u32 billboard_total = billboard_count + p_app->aggregate.impostor_count;
+	if (billboard_total == 0) return;
+
+	// this frame slot's fence has been waited on, so its ring entry is
+	// free to overwrite without a staging copy
+	_mapped_buffer *instances = &p_app->billboard.instances[p_app->sync.frame_index];
+	grow_mapped_buffer(p_app, p_app->sync.frame_index, instances, sizeof(u32) * billboard_total, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	fill->out = (u32*)instances->mapped;
+
+	u32 body_count = p_app->visibility.body_count;
+	u32 chunk_count = threaded ? p_app->workers.count + 1 : 1;
+	if (chunk_count > 1 && body_count > fill->capacity) {
+		fill->capacity = body_count * 2;
+		fill->scratch = realloc(fill->scratch, sizeof(u32) * fill->capacity);
+	}
+
+	fill->chunk_count = chunk_count;
+	for (u32 c = 0; c <= chunk_count; c++) {
+		fill->firsts[c] = (u32)((uint64_t)body_count * c / chunk_count);
+	}
+
+	run_worker_tasks(p_app, fill_billboard_chunk, chunk_count, threaded);
+
+	u32 draw_count = 0;
+	for (u32 c = 0; c < chunk_count; c++) {
+		fill->offsets[c] = draw_count;
+		draw_count += fill->counts[c];
+	}
+	if (chunk_count > 1) run_worker_tasks(p_app, copy_billboard_chunk, chunk_count, threaded);
+
+	for (u32 i = 0; i < p_app->aggregate.impostor_count; ++i) {
+		fill->out[draw_count++] = billboard_count + i;
+	}
+	fill->draw_count = draw_count;
+}
+
+// the accumulation subpass blends order independently so nothing is sorted
+static void record_transparent_pass(_app *p_app, _render_queue *queue) {
+	if (p_app->cmd.fill.draw_count == 0) return;
+
+	_draw_packet packet = {
+		.pipeline = p_app->pipeline.transparent,
+		.layout = p_app->pipeline.layout,
+		.material = p_app->descriptor.sets[p_app->sync.frame_index],
+		.vertex_buffer = p_app->billboard.instances[p_app->sync.frame_index].buffer,
+		.first = 0,
+		.count = 6,
+		.instance_count = p_app->cmd.fill.draw_count,
+	};
+	push_render_queue(queue, RECORD_PASS_TRANSPARENT, 0.0f, &packet);
+}
+
+static void record_pass_task(_app *p_app, u32 pass) {
+	u32 slot = p_app->sync.frame_index * RECORD_PASS_COUNT + pass;
+	VkCommandBuffer command_buffer = p_app->cmd.secondaries[slot];
+
+	// the frame slot's fence has been waited on so the whole pool can be
+	// recycled at once, cheaper than resetting buffers one at a time
+	vkResetCommandPool(p_app->device.logical, p_app->cmd.worker_pools[slot], 0);
+
+	VkCommandBufferInheritanceInfo inheritance_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = p_app->pipeline.render_pass,
+		.subpass = pass,
+		.framebuffer = p_app->pipeline.swapchain_framebuffers[p_app->cmd.image_index],
+	};
+
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritance_info,
+	};
+
+	if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "command buffer => failed to begin secondary record");
+		exit(EXIT_FAILURE);
+	}
+
+	set_render_area(p_app, command_buffer);
+
+	// each pass fills and drains its own queue, the sort groups packets by
+	// state so the submit only binds what actually changes
+	_render_queue *queue = &p_app->cmd.queues[pass];
+	begin_render_queue(queue);
+
+	switch ((_record_pass)pass) {
+		case RECORD_PASS_OPAQUE: record_opaque_pass(p_app, queue); break;
+		case RECORD_PASS_TRANSPARENT: record_transparent_pass(p_app, queue); break;
+		default: break;
+	}
+
+	sort_render_queue(queue);
+	submit_render_queue(p_app, queue, command_buffer);
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "command buffer => failed to end secondary record");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// records this frame slot's secondaries on the persistent workers once the
+// scene is big enough to pay for the wake. the billboard fill goes first in
+// chunks across all of them, then each pass is one task. the passes only
+// read shared state and their pools and queues are their own
+void record_secondary_command_buffers(_app *p_app, u32 image_index) {
+	u32 work = p_app->visibility.body_count + p_app->aggregate.impostor_count;
+	bool threaded = p_app->workers.count > 0 && work >= RECORD_THREAD_THRESHOLD;
+
+	fill_billboard_indices(p_app, threaded);
+
+	p_app->cmd.image_index = image_index;
+	run_worker_tasks(p_app, record_pass_task, RECORD_PASS_COUNT, threaded);
+
+	// bind counts are summed once every task has finished
+	p_app->perf.binds = (_render_queue_stats){0};
+	for (u32 p = 0; p < RECORD_PASS_COUNT; p++) {
+		_render_queue_stats *stats = &p_app->cmd.queues[p].stats;
+		p_app->perf.binds.pipeline_binds += stats->pipeline_binds;
+		p_app->perf.binds.vertex_binds += stats->vertex_binds;
+		p_app->perf.binds.index_binds += stats->index_binds;
+		p_app->perf.binds.descriptor_binds += stats->descriptor_binds;
+		p_app->perf.binds.draws += stats->draws;
+	}
+}
+
+// the grid, composite, lens pass and present blit only change with the
+// swapchain or a descriptor rebind, so they are recorded once per swapchain
+// image and frame slot and replayed until invalidated
+void create_static_command_buffers(_app *p_app) {
+	if (p_app->cmd.static_pool == VK_NULL_HANDLE) {
+		VkCommandPoolCreateInfo pool_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = p_app->device.queue_indices.graphics_family,
+		};
+
+		if (vkCreateCommandPool(p_app->device.logical, &pool_info, NULL, &p_app->cmd.static_pool) != VK_SUCCESS) {
+			submit_debug_message(
+				p_app->inst.instance,
+				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+				"command pool => failed to create static command pool"
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	p_app->cmd.static_slots = p_app->swp.images_count * p_app->sync.frames_in_flight;
+	u32 count = p_app->cmd.static_slots * STATIC_PASS_COUNT;
+	p_app->cmd.statics = malloc(sizeof(VkCommandBuffer) * count);
+	p_app->cmd.static_valid = calloc(p_app->cmd.static_slots, sizeof(bool));
+
+	VkCommandBufferAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = p_app->cmd.static_pool,
+		.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+		.commandBufferCount = count,
+	};
+
+	if (vkAllocateCommandBuffers(p_app->device.logical, &alloc_info, p_app->cmd.statics) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"command buffer => failed to allocate static command buffers"
+		);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// a descriptor set update invalidates every command buffer that bound it,
+// so growing a frame's buffers has to drop that frame's recordings
+void invalidate_static_command_buffers(_app *p_app, u32 frame_index) {
+	for (u32 i = 0; i < p_app->swp.images_count; i++) {
+		p_app->cmd.static_valid[i * p_app->sync.frames_in_flight + frame_index] = false;
+	}
+}
+
+static void record_grid_pass(_app *p_app, VkCommandBuffer command_buffer) {
+	set_render_area(p_app, command_buffer);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+												 p_app->pipeline.layout, 0, 1,
+												 &p_app->descriptor.sets[p_app->sync.frame_index], 0, NULL);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_app->pipeline.grid);
+	VkDeviceSize grid_offset = 0;
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &p_app->grid.vertex_buffer, &grid_offset);
+	vkCmdDraw(command_buffer, p_app->grid.vertex_count, 1, 0, 0);
+}
+
+static void record_composite_pass(_app *p_app, VkCommandBuffer command_buffer) {
+	set_render_area(p_app, command_buffer);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_app->oit.composite.pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+												 p_app->oit.composite.layout, 0, 1,
+												 &p_app->oit.descriptor.sets[p_app->sync.frame_index], 0, NULL);
+	vkCmdDraw(command_buffer, 3, 1, 0, 0);
+}
+
+static void record_lens_pass(_app *p_app, VkCommandBuffer command_buffer) {
+	set_render_area(p_app, command_buffer);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_app->lens.pass.pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+												 p_app->lens.pass.layout, 0, 1,
+												 &p_app->lens.descriptor.sets[p_app->sync.frame_index], 0, NULL);
+	vkCmdDraw(command_buffer, 3, 1, 0, 0);
+}
+
+// lensed target blitted onto the swapchain image and handed to present,
+// recorded outside any render pass
+static void record_present_pass(_app *p_app, VkCommandBuffer command_buffer, u32 image_index) {
+	VkImageMemoryBarrier to_transfer_dst = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = p_app->swp.images[image_index],
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0, .levelCount = 1,
+			.baseArrayLayer = 0, .layerCount = 1,
+		},
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+	};
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &to_transfer_dst);
+
+	VkImageBlit blit = {
+		.srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+		.srcOffsets[0] = { 0, 0, 0 },
+		.srcOffsets[1] = { (i32)p_app->swp.render_extent.width, (i32)p_app->swp.render_extent.height, 1 },
+		.dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+		.dstOffsets[0] = { 0, 0, 0 },
+		.dstOffsets[1] = { (i32)p_app->swp.extent.width, (i32)p_app->swp.extent.height, 1 },
+	};
+	vkCmdBlitImage(command_buffer,
+								p_app->lens.target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+								p_app->swp.images[image_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+								1, &blit, VK_FILTER_LINEAR);
+
+	VkImageMemoryBarrier to_present = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = p_app->swp.images[image_index],
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0, .levelCount = 1,
+			.baseArrayLayer = 0, .layerCount = 1,
+		},
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = 0,
+	};
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &to_present);
+}
+
+static void record_static_pass(_app *p_app, VkCommandBuffer command_buffer, _static_pass pass, u32 image_index) {
+	VkCommandBufferInheritanceInfo inheritance_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+	};
+	VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+
+	switch (pass) {
+		case STATIC_PASS_GRID:
+			inheritance_info.renderPass = p_app->pipeline.render_pass;
+			inheritance_info.subpass = 0;
+			inheritance_info.framebuffer = p_app->pipeline.swapchain_framebuffers[image_index];
+			break;
+		case STATIC_PASS_COMPOSITE:
+			inheritance_info.renderPass = p_app->pipeline.render_pass;
+			inheritance_info.subpass = 2;
+			inheritance_info.framebuffer = p_app->pipeline.swapchain_framebuffers[image_index];
+			break;
+		case STATIC_PASS_LENS:
+			inheritance_info.renderPass = p_app->lens.pass.render_pass;
+			inheritance_info.subpass = 0;
+			inheritance_info.framebuffer = p_app->lens.pass.framebuffer;
+			break;
+		default:
+			flags = 0;
+			break;
+	}
+
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = flags,
+		.pInheritanceInfo = &inheritance_info,
+	};
+
+	if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "command buffer => failed to begin static record");
+		exit(EXIT_FAILURE);
+	}
+
+	switch (pass) {
+		case STATIC_PASS_GRID: record_grid_pass(p_app, command_buffer); break;
+		case STATIC_PASS_COMPOSITE: record_composite_pass(p_app, command_buffer); break;
+		case STATIC_PASS_LENS: record_lens_pass(p_app, command_buffer); break;
+		case STATIC_PASS_PRESENT: record_present_pass(p_app, command_buffer, image_index); break;
+		default: break;
+	}
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "command buffer => failed to end static record");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// records this image and frame slot's static passes if they were dropped.
+// the frame slot's fence has been waited on and a slot is only ever
+// executed by its own frame, so nothing recorded here can still be pending
+void prepare_static_command_buffers(_app *p_app, u32 image_index) {
+	u32 slot = image_index * p_app->sync.frames_in_flight + p_app->sync.frame_index;
+	if (p_app->cmd.static_valid[slot]) return;
+
+	for (u32 p = 0; p < STATIC_PASS_COUNT; p++) {
+		record_static_pass(p_app, p_app->cmd.statics[slot * STATIC_PASS_COUNT + p], (_static_pass)p, image_index);
+	}
+	p_app->cmd.static_valid[slot] = true;
+}
+
+VkCommandBuffer get_static_command_buffer(_app *p_app, u32 image_index, _static_pass pass) {
+	u32 slot = image_index * p_app->sync.frames_in_flight + p_app->sync.frame_index;
+	return p_app->cmd.statics[slot * STATIC_PASS_COUNT + pass];
+}
+
+// the recordings name swapchain images and framebuffers, so a recreated
+// swapchain hands them to this frame slot's deletion queue while frames
+// still in flight may be executing them, then allocates for the new images
+void retire_static_command_buffers(_app *p_app, u32 frame_index) {
+	defer_command_buffer_destruction(p_app, frame_index, p_app->cmd.static_pool, p_app->cmd.statics, p_app->cmd.static_slots * STATIC_PASS_COUNT);
+	p_app->cmd.statics = NULL;
+	free(p_app->cmd.static_valid);
+	p_app->cmd.static_valid = NULL;
+	p_app->cmd.static_slots = 0;
+}
+
+void destroy_static_command_buffers(_app *p_app) {
+	if (p_app->cmd.statics) {
+		vkFreeCommandBuffers(p_app->device.logical, p_app->cmd.static_pool, p_app->cmd.static_slots * STATIC_PASS_COUNT, p_app->cmd.statics);
+	}
+	free(p_app->cmd.statics);
+	p_app->cmd.statics = NULL;
+	free(p_app->cmd.static_valid);
+	p_app->cmd.static_valid = NULL;
+	p_app->cmd.static_slots = 0;
+}
+
+void destroy_record_pools(_app *p_app) {
+	free(p_app->cmd.fill.scratch);
+	p_app->cmd.fill = (_record_fill){0};
+
+	// destroying a pool frees its buffers with it
+	for (u32 i = 0; i < p_app->sync.frames_in_flight * RECORD_PASS_COUNT; i++) {
+		vkDestroyCommandPool(p_app->device.logical, p_app->cmd.worker_pools[i], NULL);
+	}
+	free(p_app->cmd.worker_pools);
+	p_app->cmd.worker_pools = NULL;
+	for (u32 p = 0; p < RECORD_PASS_COUNT; p++) {
+		destroy_render_queue(&p_app->cmd.queues[p]);
+	}
+	free(p_app->cmd.secondaries);
+	p_app->cmd.secondaries = NULL;
+
+	destroy_static_command_buffers(p_app);
+	vkDestroyCommandPool(p_app->device.logical, p_app->cmd.static_pool, NULL);
+	p_app->cmd.static_pool = VK_NULL_HANDLE;
+}
@@ -0,0 +1,307 @@
+#include "headers/render_queue.h"
+#include "headers/cull.h"
+#include "headers/pipeline.h"
+
+enum {
+	RENDER_QUEUE_STATE_PIPELINE,
+	RENDER_QUEUE_STATE_MESH,
+	RENDER_QUEUE_STATE_MATERIAL,
+	RENDER_QUEUE_STATE_COUNT,
+};
+
+void create_render_queue(_render_queue *queue) {
+	*queue = (_render_queue){0};
+	queue->capacity = RENDER_QUEUE_INITIAL_CAPACITY;
+	queue->packets = malloc(sizeof(_draw_packet) * queue->capacity);
+	queue->order = malloc(sizeof(_draw_sort) * queue->capacity);
+	queue->scratch = malloc(sizeof(_draw_sort) * queue->capacity);
+	queue->previous = malloc(sizeof(u32) * queue->capacity);
+	queue->states = malloc(sizeof(uint64_t) * RENDER_QUEUE_STATE_COUNT * RENDER_QUEUE_MAX_STATES);
+}
+
+void begin_render_queue(_render_queue *queue) {
+	queue->count = 0;
+	memset(queue->state_counts, 0, sizeof(queue->state_counts));
+	queue->stats = (_render_queue_stats){0};
+}
+
+// handles are numbered in the order they are first seen each frame, only
+// equality matters for grouping. a frame with more distinct handles than
+// the field holds shares the last id, which costs binds but never a wrong one
+static uint64_t intern_state(_render_queue *queue, u32 field, uint64_t handle) {
+	uint64_t *states = queue->states + field * RENDER_QUEUE_MAX_STATES;
+	u32 count = queue->state_counts[field];
+
+	for (u32 i = 0; i < count; i++) {
+		if (states[i] == handle) return i;
+	}
+	if (count == RENDER_QUEUE_MAX_STATES) return RENDER_QUEUE_MAX_STATES - 1;
+
+	states[count] = handle;
+	queue->state_counts[field] = count + 1;
+	return count;
+}
+
+// distances are never negative so their ieee bits order like the floats,
+// the top bits past the sign give a front to back key
+static uint64_t depth_key(float depth) {
+	if (!(depth > 0.0f)) return 0;
+	u32 bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return (bits >> (31 - RENDER_QUEUE_DEPTH_BITS)) & ((1u << RENDER_QUEUE_DEPTH_BITS) - 1);
+}
+
+void push_render_queue(_render_queue *queue, u32 pass, float depth, const _draw_packet *packet) {
+	if (queue->count == queue->capacity) {
+		queue->capacity *= 2;
+		queue->packets = realloc(queue->packets, sizeof(_draw_packet) * queue->capacity);
+		queue->order = realloc(queue->order, sizeof(_draw_sort) * queue->capacity);
+		queue->scratch = realloc(queue->scratch, sizeof(_draw_sort) * queue->capacity);
+		queue->previous = realloc(queue->previous, sizeof(u32) * queue->capacity);
+	}
+
+	uint64_t pipeline = intern_state(queue, RENDER_QUEUE_STATE_PIPELINE, (uint64_t)(uintptr_t)packet->pipeline);
+	uint64_t mesh = intern_state(queue, RENDER_QUEUE_STATE_MESH, (uint64_t)(uintptr_t)packet->vertex_buffer ^ ((uint64_t)(uintptr_t)packet->index_buffer << 1));
+	uint64_t material = intern_state(queue, RENDER_QUEUE_STATE_MATERIAL, (uint64_t)(uintptr_t)packet->material);
+
+	_draw_packet *slot = &queue->packets[queue->count];
+	*slot = *packet;
+	slot->key = ((uint64_t)(pass & ((1u << RENDER_QUEUE_PASS_BITS) - 1)) << RENDER_QUEUE_PASS_SHIFT)
+		| (pipeline << RENDER_QUEUE_PIPELINE_SHIFT)
+		| (mesh << RENDER_QUEUE_MESH_SHIFT)
+		| (material << RENDER_QUEUE_MATERIAL_SHIFT)
+		| (depth_key(depth) << RENDER_QUEUE_DEPTH_SHIFT);
+
+	queue->order[queue->count] = (_draw_sort){ .key = slot->key, .index = queue->count };
+	queue->count++;
+}
+
+// lsd radix over eight 8 bit digits of the key, ping ponging between order
+// and the scratch array. most fields are a handful of small ids, so most
+// digits are shared by every key and their passes are skipped
+static void radix_sort_render_queue(_render_queue *queue) {
+	u32 count = queue->count;
+
+	u32 histogram[8][256] = {0};
+	for (u32 i = 0; i < count; i++) {
+		uint64_t key = queue->order[i].key;
+		for (u32 d = 0; d < 8; d++) {
+			histogram[d][(key >> (d * 8)) & 0xFF]++;
+		}
+	}
+
+	_draw_sort *src = queue->order;
+	_draw_sort *dst = queue->scratch;
+
+	for (u32 pass = 0; pass < 8; pass++) {
+		u32 shift = pass * 8;
+
+		if (histogram[pass][(src[0].key >> shift) & 0xFF] == count) continue;
+
+		u32 offsets[256];
+		u32 sum = 0;
+		for (u32 d = 0; d < 256; d++) {
+			offsets[d] = sum;
+			sum += histogram[pass][d];
+		}
+
+		for (u32 i = 0; i < count; i++) {
+			u32 digit = (src[i].key >> shift) & 0xFF;
+			dst[offsets[digit]++] = src[i];
+		}
+
+		_draw_sort *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != queue->order) {
+		queue->scratch = queue->order;
+		queue->order = src;
+	}
+}
+
+// gives up once max_moves shifts have been spent, items stays a valid
+// permutation so the caller can fall back to the radix sort
+static bool insertion_sort_render_queue(_draw_sort *items, u32 count, u32 max_moves) {
+	u32 moves = 0;
+
+	for (u32 i = 1; i < count; i++) {
+		_draw_sort item = items[i];
+		u32 j = i;
+
+		while (j > 0 && items[j - 1].key > item.key) {
+			items[j] = items[j - 1];
+			j--;
+
+			if (++moves > max_moves) {
+				items[j] = item;
+				return false;
+			}
+		}
+
+		items[j] = item;
+	}
+
+	return true;
+}
+
+// packets pushed in the same order as last frame are laid out in last
+// frame's sorted order first, which leaves keys that only drifted a little
+// nearly sorted. a bounded insertion sort then usually finishes in linear
+// time, one linear scan sends a scrambled order straight to radix
+void sort_render_queue(_render_queue *queue) {
+	u32 count = queue->count;
+
+	if (count >= 2) {
+		if (count == queue->previous_count) {
+			for (u32 i = 0; i < count; i++) {
+				queue->scratch[i] = queue->order[queue->previous[i]];
+			}
+			_draw_sort *tmp = queue->order;
+			queue->order = queue->scratch;
+			queue->scratch = tmp;
+		}
+
+		u32 descents = 0;
+		for (u32 i = 1; i < count; i++) {
+			descents += queue->order[i - 1].key > queue->order[i].key;
+		}
+
+		if (descents > 0) {
+			u32 max_moves = count < RENDER_QUEUE_INSERTION_THRESHOLD ? UINT32_MAX : count * RENDER_QUEUE_COHERENT_MOVES_PER_ITEM;
+			bool coherent = count < RENDER_QUEUE_INSERTION_THRESHOLD || descents <= count / RENDER_QUEUE_COHERENT_DESCENT_RATIO;
+			if (!coherent || !insertion_sort_render_queue(queue->order, count, max_moves)) {
+				radix_sort_render_queue(queue);
+			}
+		}
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		queue->previous[i] = queue->order[i].index;
+	}
+	queue->previous_count = count;
+}
+
+// emits the sorted packets, binding only what differs from the previous
+// packet. a secondary starts with nothing bound so the state starts empty
+void submit_render_queue(_app *p_app, _render_queue *queue, VkCommandBuffer command_buffer) {
+	VkPipeline bound_pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+	VkDescriptorSet bound_material = VK_NULL_HANDLE;
+	VkBuffer bound_vertex = VK_NULL_HANDLE;
+	VkBuffer bound_index = VK_NULL_HANDLE;
+	VkIndexType bound_index_type = VK_INDEX_TYPE_UINT32;
+
+	for (u32 i = 0; i < queue->count; i++) {
+		const _draw_packet *packet = &queue->packets[queue->order[i].index];
+
+		if (packet->material != VK_NULL_HANDLE && (packet->material != bound_material || packet->layout != bound_layout)) {
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet->layout, 0, 1, &packet->material, 0, NULL);
+			bound_material = packet->material;
+			bound_layout = packet->layout;
+			queue->stats.descriptor_binds++;
+		}
+
+		if (packet->pipeline != bound_pipeline) {
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet->pipeline);
+			bound_pipeline = packet->pipeline;
+			queue->stats.pipeline_binds++;
+		}
+
+		if (packet->vertex_buffer != VK_NULL_HANDLE && packet->vertex_buffer != bound_vertex) {
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(command_buffer, 0, 1, &packet->vertex_buffer, &offset);
+			bound_vertex = packet->vertex_buffer;
+			queue->stats.vertex_binds++;
+		}
+
+		if (packet->index_buffer != VK_NULL_HANDLE && (packet->index_buffer != bound_index || packet->index_type != bound_index_type)) {
+			vkCmdBindIndexBuffer(command_buffer, packet->index_buffer, 0, packet->index_type);
+			bound_index = packet->index_buffer;
+			bound_index_type = packet->index_type;
+			queue->stats.index_binds++;
+		}
+
+		if (packet->indirect) {
+			record_cull_draw_range(p_app, command_buffer, packet->first, packet->count);
+		} else if (packet->index_buffer != VK_NULL_HANDLE) {
+			vkCmdDrawIndexed(command_buffer, packet->count, packet->instance_count, packet->first, 0, packet->first_instance);
+		} else {
+			vkCmdDraw(command_buffer, packet->count, packet->instance_count, packet->first, packet->first_instance);
+		}
+		queue->stats.draws++;
+	}
+}
+
+void destroy_render_queue(_render_queue *queue) {
+	free(queue->packets);
+	free(queue->order);
+	free(queue->scratch);
+	free(queue->previous);
+	free(queue->states);
+	*queue = (_render_queue){0};
+}
+
+static int compare_draw_sort(const void *a, const void *b) {
+	uint64_t key_a = ((const _draw_sort*)a)->key;
+	uint64_t key_b = ((const _draw_sort*)b)->key;
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+static void push_benchmark_packets(_render_queue *queue, const float *depths, u32 count) {
+	_draw_packet packet = {0};
+	begin_render_queue(queue);
+	for (u32 i = 0; i < count; i++) {
+		push_render_queue(queue, 0, depths[i], &packet);
+	}
+}
+
+// timings for qsort, a cold radix sort and the coherent path, where the
+// same packets are pushed again with a small per frame drift in depth as a
+// moving camera would give them. every packet shares its state so the keys
+// differ only in depth, the worst case for skipping radix digits
+void benchmark_render_queue_sort() {
+	const u32 counts[] = { 10000, 100000, 1000000 };
+	const u32 max_count = counts[2];
+
+	float *depths = malloc(sizeof(float) * max_count);
+	_draw_sort *items = malloc(sizeof(_draw_sort) * max_count);
+	struct timespec start;
+
+	srand(1);
+
+	for (u32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		u32 count = counts[c];
+		_render_queue queue;
+		create_render_queue(&queue);
+
+		for (u32 i = 0; i < count; i++) {
+			depths[i] = (float)rand() / (float)RAND_MAX * 1.0e4f;
+		}
+
+		push_benchmark_packets(&queue, depths, count);
+		memcpy(items, queue.order, sizeof(_draw_sort) * count);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		qsort(items, count, sizeof(_draw_sort), compare_draw_sort);
+		double qsort_ms = elapsed_ms(&start);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		sort_render_queue(&queue);
+		double radix_ms = elapsed_ms(&start);
+
+		for (u32 i = 0; i < count; i++) {
+			depths[i] *= 1.0f + ((float)rand() / (float)RAND_MAX - 0.5f) * 1.0e-3f;
+		}
+		push_benchmark_packets(&queue, depths, count);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		sort_render_queue(&queue);
+		double coherent_ms = elapsed_ms(&start);
+
+		printf("[perf] sort %u packets: qsort %.3f ms, radix %.3f ms, coherent %.3f ms\n", count, qsort_ms, radix_ms, coherent_ms);
+		destroy_render_queue(&queue);
+	}
+
+	free(depths);
+	free(items);
+}
@@ -1,6 +1,7 @@
 #include "headers/renderpass.h"
 #include "headers/validation.h"
 #include "headers/image.h"
+#include "headers/oit.h"
 
 void create_render_pass(_app *p_app) {
 	VkAttachmentDescription colour_attachment_description = {
@@ -51,14 +52,57 @@ void create_render_pass(_app *p_app) {
 		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
 	};
 
-	VkSubpassDescription subpass = {
-		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &colour_attachment_reference,
-		.pResolveAttachments = &colour_attachment_resolve_reference,
-		.pDepthStencilAttachment = &depth_attachment_reference,
+	VkAttachmentDescription accum_attachment_description = {
+		.format = OIT_ACCUM_FORMAT,
+		.samples = p_app->device.msaa_samples,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	VkAttachmentDescription revealage_attachment_description = accum_attachment_description;
+	revealage_attachment_description.format = OIT_REVEALAGE_FORMAT;
+
+	VkAttachmentReference oit_attachment_references[] = {
+		{ .attachment = 3, .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+		{ .attachment = 4, .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
 	};
 
+	VkAttachmentReference oit_input_references[] = {
+		{ .attachment = 3, .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+		{ .attachment = 4, .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	};
+
+	// opaque geometry, then transparent accumulation against the opaque
+	// depth, then the composite over the colour attachment which resolves
+	VkSubpassDescription subpasses[] = {
+		{
+			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.colorAttachmentCount = 1,
+			.pColorAttachments = &colour_attachment_reference,
+			.pDepthStencilAttachment = &depth_attachment_reference,
+		},
+		{
+			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.colorAttachmentCount = 2,
+			.pColorAttachments = oit_attachment_references,
+			.pDepthStencilAttachment = &depth_attachment_reference,
+			// the opaque colour isnt touched here but the composite needs it
+			.preserveAttachmentCount = 1,
+			.pPreserveAttachments = (u32[]){0},
+		},
+		{
+			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.inputAttachmentCount = 2,
+			.pInputAttachments = oit_input_references,
+			.colorAttachmentCount = 1,
+			.pColorAttachments = &colour_attachment_reference,
+			.pResolveAttachments = &colour_attachment_resolve_reference,
+		},
+	};
 
 	VkSubpassDependency dependencies[] = {
 		{
@@ -71,6 +115,33 @@ void create_render_pass(_app *p_app) {
 		},
 		{
 			.srcSubpass = 0,
+			.dstSubpass = 1,
+			.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+			.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+		},
+		{
+			.srcSubpass = 0,
+			.dstSubpass = 2,
+			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+		},
+		{
+			.srcSubpass = 1,
+			.dstSubpass = 2,
+			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+			.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+		},
+		{
+			.srcSubpass = 2,
 			.dstSubpass = VK_SUBPASS_EXTERNAL,
 			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
 			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
@@ -79,14 +150,14 @@ void create_render_pass(_app *p_app) {
 		},
 	};
 
-	VkAttachmentDescription attachments[] = {colour_attachment_description, depth_attachment_description, colour_attachment_resolve};
+	VkAttachmentDescription attachments[] = {colour_attachment_description, depth_attachment_description, colour_attachment_resolve, accum_attachment_description, revealage_attachment_description};
 
 	VkRenderPassCreateInfo render_pass_create_info = {
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 		.attachmentCount = sizeof(attachments) / sizeof(attachments[0]),
 		.pAttachments = attachments,
-		.subpassCount = 1,
-		.pSubpasses = &subpass,
+		.subpassCount = sizeof(subpasses) / sizeof(subpasses[0]),
+		.pSubpasses = subpasses,
 		.dependencyCount = sizeof(dependencies) / sizeof(dependencies[0]),
 		.pDependencies = dependencies,
 	};
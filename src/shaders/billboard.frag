@@ -6,7 +6,8 @@ layout(location = 2) in flat uvec4 frag_type_data;
 layout(location = 3) in flat uvec4 frag_flags;
 layout(location = 4) in float frag_alpha;
 
-layout(location = 0) out vec4 out_colour;
+layout(location = 0) out vec4 out_accum;
+layout(location = 1) out float out_revealage;
 
 void main() {
     uint type_flags = frag_flags.x;
@@ -55,9 +56,12 @@ void main() {
         }
     }
 
-    if (is_light) {
-        out_colour = vec4(color, border_alpha);
-    } else {
-        out_colour = vec4(color, frag_alpha);
-    }
+    float alpha = is_light ? border_alpha : frag_alpha;
+
+    // weighted blended oit, nearer fragments weigh more so the unsorted
+    // average still favours what sits in front
+    float weight = alpha * clamp(3e3 * pow(1.0 - gl_FragCoord.z, 3.0), 1e-2, 3e3);
+
+    out_accum = vec4(color * alpha, alpha) * weight;
+    out_revealage = alpha;
 }
@@ -1,9 +1,6 @@
 #version 450
 
-layout(location = 0) in vec4 in_pos_w;
-layout(location = 1) in vec4 in_size_rotation;
-layout(location = 2) in uvec4 in_type_data;
-layout(location = 3) in uvec4 in_flags;
+layout(location = 0) in uint in_billboard_index;
 
 layout(location = 0) out vec2 frag_offset;
 layout(location = 1) out vec4 frag_size_rotation;
@@ -20,6 +17,46 @@ layout(set = 0, binding = 0) uniform _ubo {
     vec4 grid_params;
 } ubo;
 
+struct _billboard {
+    vec4 pos_w;
+    vec4 size_rotation;
+    uvec4 type_data;
+    uvec4 flags;
+};
+
+layout(std430, binding = 1) readonly buffer _sbo_billboards {
+    uint billboard_count;
+    uint _pad[3];
+    _billboard billboards[];
+} sbo_billboards;
+
+struct _solar_object {
+    vec3 position;
+    float _pad0;
+    vec3 velocity;
+    float _pad1;
+    vec3 acceleration;
+    float _pad2;
+
+    float mass;
+    float radius;
+
+    uint colour_id;
+    uint billboard_index;
+    uint type;
+    uint planet_type;
+    float intensity;
+    float schwarzschild_radius;
+};
+
+layout(std430, binding = 2) readonly buffer _sbo_solar_objects {
+    uint solar_object_count;
+    uint _pad[3];
+    _solar_object solar_objects[];
+} sbo_solar_objects;
+
+const uint FREE_STANDING = 0xFFFFFFFFu;
+
 const vec2 OFFSETS[6] = vec2[](
         vec2(-1.0, -1.0),
         vec2(1.0, -1.0),
@@ -30,6 +67,18 @@ const vec2 OFFSETS[6] = vec2[](
     );
 
 void main() {
+    _billboard billboard = sbo_billboards.billboards[in_billboard_index];
+
+    vec4 in_pos_w = billboard.pos_w;
+    vec4 in_size_rotation = billboard.size_rotation;
+    uvec4 in_type_data = billboard.type_data;
+    uvec4 in_flags = billboard.flags;
+
+    uint object_index = in_flags.w;
+    if (object_index != FREE_STANDING) {
+        in_pos_w.xyz = sbo_solar_objects.solar_objects[object_index].position;
+    }
+
     frag_offset = OFFSETS[gl_VertexIndex];
     frag_size_rotation = in_size_rotation;
     frag_type_data = in_type_data;
@@ -0,0 +1,28 @@
+#!/bin/sh
+# compiles every shader in this dir to build/shaders/<name>.spv, spirv.c
+# embeds them from there so run this before building the c side. only
+# shaders whose source (or lighting.glsl) changed get rebuilt, and every
+# module is put through spirv-val so a bad one fails here not at runtime
+set -e
+
+GLSLC="${GLSLC:-glslc}"
+SPIRV_VAL="${SPIRV_VAL:-spirv-val}"
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+SRC="$ROOT/src/shaders"
+OUT="$ROOT/build/shaders"
+
+mkdir -p "$OUT"
+
+for shader in "$SRC"/*.vert "$SRC"/*.frag "$SRC"/*.comp; do
+	name="$(basename "$shader")"
+	spv="$OUT/$name.spv"
+	if [ -f "$spv" ] && [ "$spv" -nt "$shader" ] && [ "$spv" -nt "$SRC/lighting.glsl" ]; then
+		continue
+	fi
+	echo "glslc $name"
+	if ! "$GLSLC" --target-env=vulkan1.2 -I "$SRC" "$shader" -o "$spv" ||
+		! "$SPIRV_VAL" --target-env vulkan1.2 "$spv"; then
+		rm -f "$spv"
+		exit 1
+	fi
+done
@@ -0,0 +1,27 @@
+#version 450
+
+layout(constant_id = 0) const int SAMPLE_COUNT = 1;
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInputMS in_accum;
+layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInputMS in_revealage;
+
+layout(location = 0) out vec4 out_colour;
+
+void main() {
+    vec4 accum = vec4(0.0);
+    float revealage = 0.0;
+
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        accum += subpassLoad(in_accum, i);
+        revealage += subpassLoad(in_revealage, i).r;
+    }
+
+    accum /= float(SAMPLE_COUNT);
+    revealage /= float(SAMPLE_COUNT);
+
+    // nothing transparent covered this pixel
+    if (revealage >= 1.0) discard;
+
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    out_colour = vec4(average, 1.0 - revealage);
+}
@@ -0,0 +1,76 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) in vec3 frag_view_pos;
+layout(location = 1) flat in vec3 frag_view_centre;
+layout(location = 2) flat in float frag_radius;
+layout(location = 3) flat in uint frag_object_index;
+
+layout(location = 0) out vec4 out_colour;
+
+// the hit is always in front of the quad's plane, so the written depth
+// never exceeds the rasterised one
+layout(depth_less) out float gl_FragDepth;
+
+layout(set = 0, binding = 0) uniform _ubo {
+    mat4 proj;
+    mat4 view;
+    mat4 inv_proj;
+    mat4 inv_view;
+    vec4 ambient;
+    vec4 grid_params;
+} ubo;
+
+struct _solar_object {
+    vec3 position;
+    float _pad0;
+    vec3 velocity;
+    float _pad1;
+    vec3 acceleration;
+    float _pad2;
+
+    float mass;
+    float radius;
+
+    uint colour_id;
+    uint billboard_index;
+    uint type;
+    uint planet_type;
+    float intensity;
+    float schwarzschild_radius;
+};
+
+layout(std430, binding = 2) readonly buffer _sbo_solar_objects {
+    uint solar_object_count;
+    uint _pad[3];
+    _solar_object objects[];
+} sbo_solar_objects;
+
+#include "lighting.glsl"
+
+void main() {
+    // view space ray from the eye through this pixel against the sphere
+    vec3 ray = normalize(frag_view_pos);
+    float b = dot(ray, frag_view_centre);
+    float c = dot(frag_view_centre, frag_view_centre) - frag_radius * frag_radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0) discard;
+
+    vec3 hit = ray * (b - sqrt(discriminant));
+    vec3 normal = (hit - frag_view_centre) / frag_radius;
+
+    vec4 clip = ubo.proj * vec4(hit, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+
+    _solar_object self = sbo_solar_objects.objects[frag_object_index];
+    vec3 surface_colour = unpack_colour(self.colour_id);
+
+    if (self.type == SOLAR_OBJECT_TYPE_LIGHT_EMIT) {
+        out_colour = vec4(surface_colour, 1.0);
+        return;
+    }
+
+    vec3 world_pos = (ubo.inv_view * vec4(hit, 1.0)).xyz;
+    vec3 world_normal = normalize(mat3(ubo.inv_view) * normal);
+    out_colour = vec4(shade_surface(frag_object_index, surface_colour, world_pos, world_normal), 1.0);
+}
@@ -0,0 +1,76 @@
+#version 450
+
+// a body drawn as a camera facing quad, impostor.frag ray traces the sphere
+// inside it. the quad sits on the plane through the centre and is widened
+// so the silhouette cone from the eye fits inside
+
+layout(location = 0) in vec4 in_pos;
+
+layout(location = 0) out vec3 frag_view_pos;
+layout(location = 1) flat out vec3 frag_view_centre;
+layout(location = 2) flat out float frag_radius;
+layout(location = 3) flat out uint frag_object_index;
+
+layout(constant_id = 0) const float RADIUS_MODIFIER = 1.0;
+
+layout(set = 0, binding = 0) uniform _ubo {
+    mat4 proj;
+    mat4 view;
+    mat4 inv_proj;
+    mat4 inv_view;
+    vec4 ambient;
+    vec4 grid_params;
+} ubo;
+
+struct _solar_object {
+    vec3 position;
+    float _pad0;
+    vec3 velocity;
+    float _pad1;
+    vec3 acceleration;
+    float _pad2;
+
+    float mass;
+    float radius;
+
+    uint colour_id;
+    uint billboard_index;
+    uint type;
+    uint planet_type;
+    float intensity;
+    float schwarzschild_radius;
+};
+
+layout(std430, binding = 2) readonly buffer _sbo_solar_objects {
+    uint solar_object_count;
+    uint _pad[3];
+    _solar_object solar_objects[];
+} sbo_solar_objects;
+
+// written by the cull pass, each lod's draw starts at its own firstInstance
+layout(std430, binding = 4) readonly buffer _sbo_culled_instances {
+    uint object_indices[];
+} sbo_culled_instances;
+
+void main() {
+    uint object_index = sbo_culled_instances.object_indices[gl_InstanceIndex];
+    _solar_object obj = sbo_solar_objects.solar_objects[object_index];
+
+    vec3 centre = (ubo.view * vec4(obj.position, 1.0)).xyz;
+    float radius = obj.radius * RADIUS_MODIFIER;
+
+    float dist = length(centre);
+    vec3 dir = centre / dist;
+    vec3 side = abs(dir.y) < 0.999 ? normalize(cross(dir, vec3(0.0, 1.0, 0.0))) : vec3(1.0, 0.0, 0.0);
+    vec3 up = cross(side, dir);
+
+    float extent = radius * dist / sqrt(max(dist * dist - radius * radius, 1e-4 * dist * dist));
+    vec3 view_pos = centre + (in_pos.x * side + in_pos.y * up) * extent;
+
+    gl_Position = ubo.proj * vec4(view_pos, 1.0);
+
+    frag_view_pos = view_pos;
+    frag_view_centre = centre;
+    frag_radius = radius;
+    frag_object_index = object_index;
+}
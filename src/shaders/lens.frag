@@ -38,10 +38,10 @@ layout(std430, binding = 1) readonly buffer _sbo_solar_objects {
 layout(set = 0, binding = 2) uniform sampler2D scene_tex;
 
 const uint SOLAR_OBJECT_TYPE_BLACKHOLE = 3u;
-const float INFLUENCE_FACTOR = 50.0;
-const int MAX_RK4_STEPS = 256;
+layout(constant_id = 0) const int MAX_RK4_STEPS = 256;
+layout(constant_id = 1) const float INFLUENCE_FACTOR = 50.0;
+layout(constant_id = 2) const float DPHI_BASE = 0.025;
 const float ESCAPE_U_FACTOR = 0.005;
-const float DPHI_BASE = 0.025;
 
 // Schwarzschild null geodesic in (u = 1/r, phi):
 //   d^2 u / dphi^2 + u = 1.5 * rs * u^2
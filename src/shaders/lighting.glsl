@@ -0,0 +1,41 @@
+// shared by mesh.frag and impostor.frag, the including shader declares the
+// ubo and sbo_solar_objects before pulling this in
+
+const uint SOLAR_OBJECT_TYPE_PLAIN = 0u;
+const uint SOLAR_OBJECT_TYPE_LIGHT_EMIT = 1u;
+
+vec3 unpack_colour(uint packed_colour) {
+    return vec3(
+        float((packed_colour >> 16) & 0xFF) / 255.0,
+        float((packed_colour >> 8) & 0xFF) / 255.0,
+        float(packed_colour & 0xFF) / 255.0
+    );
+}
+
+// ambient plus every light emitting body except the surface's own
+vec3 shade_surface(uint self_index, vec3 surface_colour, vec3 world_pos, vec3 surface_normal) {
+    vec3 diffuse_light = ubo.ambient.xyz * ubo.ambient.w;
+
+    for (uint i = 0u; i < sbo_solar_objects.solar_object_count; i++) {
+        if (i == self_index) continue;
+
+        _solar_object light = sbo_solar_objects.objects[i];
+        if (light.type != SOLAR_OBJECT_TYPE_LIGHT_EMIT) continue;
+
+        vec3 light_direction = light.position - world_pos;
+
+        float distance_sq = dot(light_direction, light_direction);
+        float attenuation = 1.0 / max(distance_sq, 0.0001);
+
+        light_direction = normalize(light_direction);
+
+        float cos_ang_incidence = max(dot(surface_normal, light_direction), 0.0);
+
+        vec3 light_colour = unpack_colour(light.colour_id);
+        vec3 intensity = light_colour * light.intensity * attenuation;
+
+        diffuse_light += intensity * cos_ang_incidence;
+    }
+
+    return diffuse_light * surface_colour;
+}
@@ -1,10 +1,13 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : enable
 
-layout(location = 0) in vec3 in_pos;
+layout(location = 0) in vec4 in_pos;
 layout(location = 1) in vec2 in_uv;
-layout(location = 2) in vec3 in_norm;
-layout(location = 3) in uvec4 in_data;
+layout(location = 2) in vec2 in_norm;
+
+// positions are snorm16 in the unit cube, the lod radius modifier is
+// applied here instead of being baked into the quantised values
+layout(constant_id = 0) const float RADIUS_MODIFIER = 1.0;
 
 layout(location = 0) out vec3 frag_pos;
 layout(location = 1) out vec2 frag_uv;
@@ -46,20 +49,28 @@ layout(std430, binding = 2) readonly buffer _sbo_solar_objects {
     _solar_object solar_objects[];
 } sbo_solar_objects;
 
-layout(push_constant) uniform push_constants {
-    uint object_index;
-} pc;
+// written by the cull pass, each lod's draw starts at its own firstInstance
+layout(std430, binding = 4) readonly buffer _sbo_culled_instances {
+    uint object_indices[];
+} sbo_culled_instances;
+
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main() {
-    _solar_object obj = sbo_solar_objects.solar_objects[pc.object_index];
+    uint object_index = sbo_culled_instances.object_indices[gl_InstanceIndex];
+    _solar_object obj = sbo_solar_objects.solar_objects[object_index];
 
-    vec3 world_pos = in_pos * obj.radius + obj.position;
+    vec3 world_pos = in_pos.xyz * RADIUS_MODIFIER * obj.radius + obj.position;
 
     gl_Position = ubo.proj * ubo.view * vec4(world_pos, 1.0);
 
     frag_pos = world_pos;
-    frag_norm = normalize(in_norm);
+    frag_norm = decode_octahedral(in_norm);
     frag_uv = in_uv;
-    frag_data = uvec4(obj.colour_id, in_data.y, in_data.z, in_data.w);
-    frag_object_index = pc.object_index;
+    frag_data = uvec4(obj.colour_id, 0u, 0u, 0u);
+    frag_object_index = object_index;
 }
@@ -0,0 +1,10 @@
+#version 450
+
+layout(location = 0) in vec3 frag_colour;
+layout(location = 1) in float frag_brightness;
+
+layout(location = 0) out vec4 out_colour;
+
+void main() {
+    out_colour = vec4(frag_colour * frag_brightness, frag_brightness);
+}
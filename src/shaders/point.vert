@@ -0,0 +1,73 @@
+#version 450
+
+layout(location = 0) out vec3 frag_colour;
+layout(location = 1) out float frag_brightness;
+
+layout(set = 0, binding = 0) uniform _ubo {
+    mat4 proj;
+    mat4 view;
+    mat4 inv_proj;
+    mat4 inv_view;
+    vec4 ambient;
+    vec4 grid_params;
+} ubo;
+
+struct _solar_object {
+    vec3 position;
+    float _pad0;
+    vec3 velocity;
+    float _pad1;
+    vec3 acceleration;
+    float _pad2;
+
+    float mass;
+    float radius;
+
+    uint colour_id;
+    uint billboard_index;
+    uint type;
+    uint planet_type;
+    float intensity;
+    float schwarzschild_radius;
+};
+
+layout(std430, binding = 2) readonly buffer _sbo_solar_objects {
+    uint solar_object_count;
+    uint _pad[3];
+    _solar_object solar_objects[];
+} sbo_solar_objects;
+
+layout(std430, binding = 3) readonly buffer _sbo_instances {
+    uint object_indices[];
+} sbo_instances;
+
+// apparent magnitude range mapped onto point brightness
+const float MAGNITUDE_BRIGHT = -6.0;
+const float MAGNITUDE_FAINT = 6.0;
+const float MIN_BRIGHTNESS = 0.08;
+const float REFLECTED_ALBEDO = 0.3;
+
+vec3 unpack_colour(uint packed_colour) {
+    return vec3(
+        float((packed_colour >> 16) & 0xFF) / 255.0,
+        float((packed_colour >> 8) & 0xFF) / 255.0,
+        float(packed_colour & 0xFF) / 255.0
+    );
+}
+
+void main() {
+    _solar_object obj = sbo_solar_objects.solar_objects[sbo_instances.object_indices[gl_VertexIndex]];
+
+    vec3 camera_pos = ubo.inv_view[3].xyz;
+    vec3 to_camera = camera_pos - obj.position;
+    float dist2 = max(dot(to_camera, to_camera), 1e-6);
+
+    float luminosity = obj.intensity > 0.0 ? obj.intensity : REFLECTED_ALBEDO * obj.radius * obj.radius;
+    float magnitude = -2.5 * log(max(luminosity / dist2, 1e-30)) / log(10.0);
+
+    frag_brightness = clamp((MAGNITUDE_FAINT - magnitude) / (MAGNITUDE_FAINT - MAGNITUDE_BRIGHT), MIN_BRIGHTNESS, 1.0);
+    frag_colour = unpack_colour(obj.colour_id);
+
+    gl_Position = ubo.proj * ubo.view * vec4(obj.position, 1.0);
+    gl_PointSize = 1.0;
+}
@@ -0,0 +1,33 @@
+#include "headers/spirv.h"
+
+// the compiled shaders are pulled in by the assembler at build time, paths
+// are relative to the repo root the build runs from. src/shaders/compile.sh
+// writes them from the glsl so they can never go stale against the source.
+// nothing is read from disk at startup and a missing .spv fails the build
+// rather than the run
+#define EMBED_SPIRV(name, path) \
+	__asm__( \
+		".section .rodata\n" \
+		".balign 4\n" \
+		".global spirv_" #name "\n" \
+		"spirv_" #name ":\n" \
+		".incbin \"" path "\"\n" \
+		".global spirv_" #name "_end\n" \
+		"spirv_" #name "_end:\n" \
+		".previous\n" \
+	);
+
+EMBED_SPIRV(mesh_vert, "build/shaders/mesh.vert.spv")
+EMBED_SPIRV(mesh_frag, "build/shaders/mesh.frag.spv")
+EMBED_SPIRV(billboard_vert, "build/shaders/billboard.vert.spv")
+EMBED_SPIRV(billboard_frag, "build/shaders/billboard.frag.spv")
+EMBED_SPIRV(grid_vert, "build/shaders/grid.vert.spv")
+EMBED_SPIRV(grid_frag, "build/shaders/grid.frag.spv")
+EMBED_SPIRV(lens_vert, "build/shaders/lens.vert.spv")
+EMBED_SPIRV(lens_frag, "build/shaders/lens.frag.spv")
+EMBED_SPIRV(composite_frag, "build/shaders/composite.frag.spv")
+EMBED_SPIRV(point_vert, "build/shaders/point.vert.spv")
+EMBED_SPIRV(point_frag, "build/shaders/point.frag.spv")
+EMBED_SPIRV(cull_comp, "build/shaders/cull.comp.spv")
+EMBED_SPIRV(impostor_vert, "build/shaders/impostor.vert.spv")
+EMBED_SPIRV(impostor_frag, "build/shaders/impostor.frag.spv")
@@ -3,6 +3,10 @@
 #include "headers/core.h"
 #include "headers/image.h"
 #include "headers/lens.h"
+#include "headers/oit.h"
+#include "headers/record.h"
+#include "headers/deletion.h"
+#include "headers/sync.h"
 
 VkSurfaceFormatKHR choose_swapchain_surface_format(_app *p_app, _swapchain_support *p_support) {
 
@@ -85,7 +89,9 @@ void create_swapchain(_app *p_app) {
 		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
 		.presentMode = present_mode,
 		.clipped = VK_TRUE,
-		.oldSwapchain = VK_NULL_HANDLE,
+		// on recreation the old swapchain is retired rather than destroyed,
+		// its images can still be presented while the new one comes up
+		.oldSwapchain = p_app->swp.swapchain,
 	};
 
 	u32 queue_family_indices[] = {p_app->device.queue_indices.graphics_family, p_app->device.queue_indices.present_family};
@@ -164,6 +170,8 @@ void create_framebuffers(_app *p_app) {
 		p_app->colour.image_view,
 		p_app->depth.image_view,
 		p_app->resolve.image_view,
+		p_app->oit.accum.image_view,
+		p_app->oit.revealage.image_view,
 	};
 
 	VkFramebufferCreateInfo framebuffer_create_info = {
@@ -188,25 +196,29 @@ void create_framebuffers(_app *p_app) {
 	}
 }
 
-void cleanup_swapchain(_app *p_app) {
-	for (size_t i = 0; i < p_app->swp.images_count; i++) {
-		vkDestroyFramebuffer(p_app->device.logical, p_app->pipeline.swapchain_framebuffers[i], NULL);
-		vkDestroyImageView(p_app->device.logical, p_app->swp.image_views[i], NULL);
+// resources retired by a recreation were last used by a frame already
+// submitted, so this slot's next wait is raised to the newest submission
+// and its deletion queue is flushed only once the gpu is past all of them
+static void retire_render_targets(_app *p_app, u32 frame_index) {
+	defer_image_destruction(p_app, frame_index, p_app->colour.image, p_app->colour.image_view, p_app->colour.image_allocation);
+	defer_image_destruction(p_app, frame_index, p_app->depth.image, p_app->depth.image_view, p_app->depth.image_allocation);
+	defer_image_destruction(p_app, frame_index, p_app->resolve.image, p_app->resolve.image_view, p_app->resolve.image_allocation);
+	retire_oit_resources(p_app, frame_index);
+	retire_lens_target(p_app, frame_index);
+}
+
+static void retire_framebuffers(_app *p_app, u32 frame_index, u32 count) {
+	for (u32 i = 0; i < count; i++) {
+		defer_framebuffer_destruction(p_app, frame_index, p_app->pipeline.swapchain_framebuffers[i]);
 	}
 	free(p_app->pipeline.swapchain_framebuffers);
-	free(p_app->swp.image_views);
-
-
-	vkDestroyImageView(p_app->device.logical, p_app->depth.image_view, NULL);
-	vmaDestroyImage(p_app->mem.alloc, p_app->depth.image, p_app->depth.image_allocation);
-	vkDestroyImageView(p_app->device.logical, p_app->colour.image_view, NULL);
-	vmaDestroyImage(p_app->mem.alloc, p_app->colour.image, p_app->colour.image_allocation);
-	vkDestroyImageView(p_app->device.logical, p_app->resolve.image_view, NULL);
-	vmaDestroyImage(p_app->mem.alloc, p_app->resolve.image, p_app->resolve.image_allocation);
-
-	vkDestroySwapchainKHR(p_app->device.logical, p_app->swp.swapchain, NULL);
+	p_app->pipeline.swapchain_framebuffers = NULL;
 }
 
+// nothing waits for the device to idle. the static recordings naming the
+// old swapchain are deferred to this frame slot, the swapchain and its
+// views wait out the new one's presents, and the render targets only
+// follow when the render extent actually changed
 void recreate_swapchain(_app *p_app) {
 	int width = 0, height = 0;
 	while (width == 0 || height == 0) {
@@ -214,16 +226,53 @@ void recreate_swapchain(_app *p_app) {
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(p_app->device.logical);
+	u32 frame_index = p_app->sync.frame_index;
+	u32 old_images_count = p_app->swp.images_count;
+	VkExtent2D old_render_extent = p_app->swp.render_extent;
+	VkSwapchainKHR old_swapchain = p_app->swp.swapchain;
+	VkImageView *old_image_views = p_app->swp.image_views;
 
-	cleanup_lens_swapchain(p_app);
-	cleanup_swapchain(p_app);
+	retire_static_command_buffers(p_app, frame_index);
+	p_app->swp.image_views = NULL;
+	free(p_app->swp.images);
+	p_app->swp.images = NULL;
 
 	create_swapchain(p_app);
+	defer_swapchain_destruction(p_app, old_swapchain, old_image_views, old_images_count, p_app->swp.images_count);
 	create_image_views(p_app);
-	create_colour_resources(p_app);
-	create_depth_resources(p_app);
-	create_resolve_resources(p_app);
-	create_framebuffers(p_app);
-	recreate_lens_swapchain(p_app);
+	grow_render_finished_semaphores(p_app);
+
+	bool resized = p_app->swp.render_extent.width != old_render_extent.width || p_app->swp.render_extent.height != old_render_extent.height;
+	if (resized) {
+		retire_render_targets(p_app, frame_index);
+		create_colour_resources(p_app);
+		create_depth_resources(p_app);
+		create_resolve_resources(p_app);
+		create_oit_resources(p_app);
+		create_lens_image(p_app);
+		create_lens_framebuffer(p_app);
+
+		// every slot's sets still name the old targets, each is rewritten
+		// once its own frames have finished with them
+		p_app->swp.stale_target_slots = (1u << p_app->sync.frames_in_flight) - 1;
+	}
+
+	if (resized || p_app->swp.images_count != old_images_count) {
+		retire_framebuffers(p_app, frame_index, old_images_count);
+		create_framebuffers(p_app);
+	}
+
+	create_static_command_buffers(p_app);
+
+	p_app->sync.frame_values[frame_index] = p_app->sync.timeline_value;
+}
+
+// repoints this slot's lens and composite sets at the current render
+// targets, called after the slot's wait so none of its frames still use them
+void refresh_target_descriptors(_app *p_app, u32 frame_index) {
+	if (!(p_app->swp.stale_target_slots & (1u << frame_index))) return;
+
+	write_lens_descriptor_set(p_app, frame_index);
+	write_oit_descriptor_set(p_app, frame_index);
+	p_app->swp.stale_target_slots &= ~(1u << frame_index);
 }
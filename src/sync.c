@@ -3,22 +3,19 @@
 
 void create_sync_objects(_app *p_app) {
 
-	p_app->sync.image_available_semaphores = malloc(sizeof(VkSemaphore) * p_app->swp.images_count);
-	p_app->sync.render_finished_semaphores = malloc(sizeof(VkSemaphore) * p_app->swp.images_count);
-	p_app->sync.in_flight_fences = malloc(sizeof(VkFence) * MAX_FRAMES_IN_FLIGHT);
+	// an acquire semaphore is handed out per frame slot, a present semaphore
+	// per image since it is only free again once that image is reacquired
+	p_app->sync.image_available_semaphores = malloc(sizeof(VkSemaphore) * p_app->sync.frames_in_flight);
+	p_app->sync.render_finished_semaphores = NULL;
+	p_app->sync.render_finished_count = 0;
+	p_app->sync.frame_values = calloc(p_app->sync.frames_in_flight, sizeof(uint64_t));
 
 	VkSemaphoreCreateInfo semaphore_create_info = {
 		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
 	};
 
-	VkFenceCreateInfo fence_create_info = {	
-		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		.flags = VK_FENCE_CREATE_SIGNALED_BIT,
-	};
-
-	for (u32 i = 0; i < p_app->swp.images_count; i++) {
-		if (vkCreateSemaphore(p_app->device.logical, &semaphore_create_info, NULL, &p_app->sync.image_available_semaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(p_app->device.logical, &semaphore_create_info, NULL, &p_app->sync.render_finished_semaphores[i]) != VK_SUCCESS) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		if (vkCreateSemaphore(p_app->device.logical, &semaphore_create_info, NULL, &p_app->sync.image_available_semaphores[i]) != VK_SUCCESS) {
 			submit_debug_message(
 				p_app->inst.instance,
 				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
@@ -28,14 +25,105 @@ void create_sync_objects(_app *p_app) {
 		}
 	}
 
-	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		if (vkCreateFence(p_app->device.logical, &fence_create_info, NULL, &p_app->sync.in_flight_fences[i]) != VK_SUCCESS) {
+	grow_render_finished_semaphores(p_app);
+
+	// starts at zero, which every slot's wait value already satisfies
+	VkSemaphoreTypeCreateInfo timeline_type_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0,
+	};
+
+	VkSemaphoreCreateInfo timeline_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &timeline_type_info,
+	};
+
+	if (vkCreateSemaphore(p_app->device.logical, &timeline_create_info, NULL, &p_app->sync.timeline) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"semaphore => failed to create timeline semaphore"
+		);
+		exit(EXIT_FAILURE);
+	}
+	p_app->sync.timeline_value = 0;
+}
+
+// a recreated swapchain may hand out more images than before, the extra
+// present semaphores are added and none are destroyed since a present of
+// the old swapchain may still be waiting on them
+void grow_render_finished_semaphores(_app *p_app) {
+	u32 count = p_app->swp.images_count;
+	if (count <= p_app->sync.render_finished_count) return;
+
+	p_app->sync.render_finished_semaphores = realloc(p_app->sync.render_finished_semaphores, sizeof(VkSemaphore) * count);
+
+	VkSemaphoreCreateInfo semaphore_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+	};
+
+	for (u32 i = p_app->sync.render_finished_count; i < count; i++) {
+		if (vkCreateSemaphore(p_app->device.logical, &semaphore_create_info, NULL, &p_app->sync.render_finished_semaphores[i]) != VK_SUCCESS) {
 			submit_debug_message(
 				p_app->inst.instance,
 				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-				"fence => failed to create fence"
+				"semaphore => failed to create semaphore"
 			);
 			exit(EXIT_FAILURE);
 		}
 	}
+	p_app->sync.render_finished_count = count;
+}
+
+// the value the next submission will signal, bumped once per submit
+uint64_t next_timeline_value(_app *p_app) {
+	return ++p_app->sync.timeline_value;
+}
+
+// the last value the gpu has signalled, every submission up to it is done
+uint64_t completed_timeline_value(_app *p_app) {
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(p_app->device.logical, p_app->sync.timeline, &value);
+	return value;
+}
+
+// blocks until the gpu has finished every submission up to value
+void wait_timeline_value(_app *p_app, uint64_t value) {
+	if (value == 0) return;
+
+	VkSemaphoreWaitInfo wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &p_app->sync.timeline,
+		.pValues = &value,
+	};
+
+	if (vkWaitSemaphores(p_app->device.logical, &wait_info, UINT64_MAX) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"semaphore => failed to wait on timeline semaphore"
+		);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void destroy_sync_objects(_app *p_app) {
+	for (u32 i = 0; i < p_app->sync.frames_in_flight; i++) {
+		vkDestroySemaphore(p_app->device.logical, p_app->sync.image_available_semaphores[i], NULL);
+	}
+	for (u32 i = 0; i < p_app->sync.render_finished_count; i++) {
+		vkDestroySemaphore(p_app->device.logical, p_app->sync.render_finished_semaphores[i], NULL);
+	}
+	vkDestroySemaphore(p_app->device.logical, p_app->sync.timeline, NULL);
+	p_app->sync.timeline = VK_NULL_HANDLE;
+
+	free(p_app->sync.image_available_semaphores);
+	p_app->sync.image_available_semaphores = NULL;
+	free(p_app->sync.render_finished_semaphores);
+	p_app->sync.render_finished_semaphores = NULL;
+	p_app->sync.render_finished_count = 0;
+	free(p_app->sync.frame_values);
+	p_app->sync.frame_values = NULL;
 }
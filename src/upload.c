@@ -0,0 +1,301 @@
+#include "headers/upload.h"
+#include "headers/validation.h"
+#include "headers/buffer.h"
+
+// uploads are staged in one persistently mapped ring and copied on the
+// transfer queue in batches, each batch signals the upload timeline when
+// done. nothing here waits on the graphics queue, the frame that first
+// needs an upload waits on its timeline value on the gpu instead
+void create_upload(_app *p_app) {
+	_app_upload *upload = &p_app->upload;
+
+	VkCommandPoolCreateInfo pool_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = p_app->device.queue_indices.transfer_family,
+	};
+
+	if (vkCreateCommandPool(p_app->device.logical, &pool_info, NULL, &upload->pool) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"command pool => failed to create upload command pool"
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	upload->batches = calloc(UPLOAD_BATCH_COUNT, sizeof(_upload_batch));
+	for (u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+		VkCommandBufferAllocateInfo alloc_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = upload->pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+
+		if (vkAllocateCommandBuffers(p_app->device.logical, &alloc_info, &upload->batches[i].command_buffer) != VK_SUCCESS) {
+			submit_debug_message(
+				p_app->inst.instance,
+				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+				"command buffer => failed to allocate upload command buffer"
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	VkSemaphoreTypeCreateInfo timeline_type_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0,
+	};
+
+	VkSemaphoreCreateInfo timeline_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &timeline_type_info,
+	};
+
+	if (vkCreateSemaphore(p_app->device.logical, &timeline_create_info, NULL, &upload->timeline) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"semaphore => failed to create upload timeline semaphore"
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	create_mapped_buffer(p_app, UPLOAD_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &upload->ring);
+
+	upload->submitted = 0;
+	upload->completed = 0;
+	upload->graphics_waited = 0;
+	upload->head = 0;
+	upload->tail = 0;
+	upload->batch_index = 0;
+	upload->recording = false;
+	upload->bytes = 0;
+	upload->copies = 0;
+}
+
+// batches finish in submission order, so the newest finished one carries
+// the furthest ring position that is free again
+static void reclaim_upload(_app *p_app) {
+	_app_upload *upload = &p_app->upload;
+	vkGetSemaphoreCounterValue(p_app->device.logical, upload->timeline, &upload->completed);
+
+	for (u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+		_upload_batch *batch = &upload->batches[i];
+		if (batch->value != 0 && batch->value <= upload->completed && batch->ring_end > upload->tail) {
+			upload->tail = batch->ring_end;
+		}
+	}
+}
+
+void wait_upload(_app *p_app, uint64_t value) {
+	_app_upload *upload = &p_app->upload;
+	if (value == 0 || value <= upload->completed) return;
+
+	VkSemaphoreWaitInfo wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &upload->timeline,
+		.pValues = &value,
+	};
+
+	if (vkWaitSemaphores(p_app->device.logical, &wait_info, UINT64_MAX) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"semaphore => failed to wait on upload timeline"
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	reclaim_upload(p_app);
+}
+
+static void release_upload_spills(_app *p_app, _upload_batch *batch) {
+	for (u32 i = 0; i < batch->spill_count; i++) {
+		destroy_mapped_buffer(p_app, &batch->spills[i]);
+	}
+	batch->spill_count = 0;
+}
+
+// opens the next batch, its command buffer is only reused once the copies
+// it last carried have finished
+static VkCommandBuffer begin_upload_batch(_app *p_app) {
+	_app_upload *upload = &p_app->upload;
+	_upload_batch *batch = &upload->batches[upload->batch_index];
+
+	if (upload->recording) return batch->command_buffer;
+
+	wait_upload(p_app, batch->value);
+	vkResetCommandBuffer(batch->command_buffer, 0);
+	release_upload_spills(p_app, batch);
+
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+
+	if (vkBeginCommandBuffer(batch->command_buffer, &begin_info) != VK_SUCCESS) {
+		submit_debug_message(p_app->inst.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "command buffer => failed to begin upload record");
+		exit(EXIT_FAILURE);
+	}
+
+	batch->copy_count = 0;
+	upload->recording = true;
+	return batch->command_buffer;
+}
+
+// submits the open batch and returns the timeline value it signals, or the
+// last submitted value when nothing was recorded
+uint64_t flush_upload(_app *p_app) {
+	_app_upload *upload = &p_app->upload;
+	if (!upload->recording) return upload->submitted;
+
+	_upload_batch *batch = &upload->batches[upload->batch_index];
+	vkEndCommandBuffer(batch->command_buffer);
+
+	batch->value = ++upload->submitted;
+	batch->ring_end = upload->head;
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &batch->value,
+	};
+
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timeline_info,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch->command_buffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &upload->timeline,
+	};
+
+	if (vkQueueSubmit(p_app->device.transfer_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+		submit_debug_message(
+			p_app->inst.instance,
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+			"transfer queue => failed to submit upload batch"
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	upload->recording = false;
+	upload->batch_index = (upload->batch_index + 1) % UPLOAD_BATCH_COUNT;
+	return batch->value;
+}
+
+// returns the ring offset of size free bytes, flushing and waiting on the
+// oldest batches while the ring is full. a span never wraps, the bytes left
+// at the end are skipped instead
+static VkDeviceSize reserve_upload(_app *p_app, VkDeviceSize size) {
+	_app_upload *upload = &p_app->upload;
+	size = (size + UPLOAD_ALIGNMENT - 1) & ~(VkDeviceSize)(UPLOAD_ALIGNMENT - 1);
+
+	for (;;) {
+		uint64_t start = upload->head;
+		VkDeviceSize offset = start % UPLOAD_RING_SIZE;
+		if (offset + size > UPLOAD_RING_SIZE) {
+			start += UPLOAD_RING_SIZE - offset;
+			offset = 0;
+		}
+
+		if (start + size - upload->tail <= UPLOAD_RING_SIZE) {
+			upload->head = start + size;
+			return offset;
+		}
+
+		// the open batch may hold the very spans that are needed back
+		flush_upload(p_app);
+		reclaim_upload(p_app);
+		if (upload->completed == upload->submitted) {
+			upload->tail = upload->head;
+			continue;
+		}
+		wait_upload(p_app, upload->completed + 1);
+	}
+}
+
+static void record_upload_copy(_app *p_app, VkBuffer src_buffer, VkDeviceSize src_offset, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkDeviceSize size) {
+	VkCommandBuffer command_buffer = begin_upload_batch(p_app);
+	VkBufferCopy region = { .srcOffset = src_offset, .dstOffset = dst_offset, .size = size };
+	vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &region);
+	p_app->upload.batches[p_app->upload.batch_index].copy_count++;
+	p_app->upload.copies++;
+	p_app->upload.bytes += size;
+}
+
+// records a copy of size bytes into dst_buffer at dst_offset and returns
+// where to write them. the span is only submitted by a later flush, so it
+// must be filled before anything else is staged or flushed. spans bigger
+// than the ring get their own staging buffer, kept until the batch is done
+void *stage_upload(_app *p_app, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkDeviceSize size) {
+	_app_upload *upload = &p_app->upload;
+
+	if (size > UPLOAD_RING_SIZE) {
+		begin_upload_batch(p_app);
+		_upload_batch *batch = &upload->batches[upload->batch_index];
+		if (batch->spill_count == batch->spill_capacity) {
+			batch->spill_capacity = batch->spill_capacity ? batch->spill_capacity * 2 : 4;
+			batch->spills = realloc(batch->spills, sizeof(_mapped_buffer) * batch->spill_capacity);
+		}
+
+		_mapped_buffer *spill = &batch->spills[batch->spill_count++];
+		create_mapped_buffer(p_app, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, spill);
+		record_upload_copy(p_app, spill->buffer, 0, dst_buffer, dst_offset, size);
+		return spill->mapped;
+	}
+
+	VkDeviceSize offset = reserve_upload(p_app, size);
+	record_upload_copy(p_app, upload->ring.buffer, offset, dst_buffer, dst_offset, size);
+	return (u8*)upload->ring.mapped + offset;
+}
+
+// copies data into dst_buffer at dst_offset once the batch is flushed. the
+// caller's memory is free to reuse on return, the bytes live in staging
+void upload_buffer(_app *p_app, VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size) {
+	if (size == 0) return;
+	memcpy(stage_upload(p_app, dst_buffer, dst_offset, size), data, size);
+}
+
+// a buffer to buffer copy the caller has already staged, done on the
+// transfer queue and waited on there since the caller frees the source
+void upload_copy_buffer(_app *p_app, VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size) {
+	record_upload_copy(p_app, src_buffer, 0, dst_buffer, 0, size);
+	wait_upload(p_app, flush_upload(p_app));
+}
+
+// flushes pending uploads and hands back the value the next graphics submit
+// has to wait on, false when it has already waited on everything submitted.
+// copies the host already saw finish are still waited on once, the gpu side
+// wait is what makes their writes visible to the graphics queue
+bool take_upload_wait(_app *p_app, uint64_t *p_value) {
+	_app_upload *upload = &p_app->upload;
+	flush_upload(p_app);
+	reclaim_upload(p_app);
+
+	if (upload->submitted == upload->graphics_waited) return false;
+
+	*p_value = upload->submitted;
+	upload->graphics_waited = upload->submitted;
+	return true;
+}
+
+void destroy_upload(_app *p_app) {
+	_app_upload *upload = &p_app->upload;
+	flush_upload(p_app);
+	wait_upload(p_app, upload->submitted);
+
+	for (u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+		release_upload_spills(p_app, &upload->batches[i]);
+		free(upload->batches[i].spills);
+	}
+	destroy_mapped_buffer(p_app, &upload->ring);
+	vkDestroySemaphore(p_app->device.logical, upload->timeline, NULL);
+	vkDestroyCommandPool(p_app->device.logical, upload->pool, NULL);
+	free(upload->batches);
+	*upload = (_app_upload){0};
+}
@@ -0,0 +1,121 @@
+#include "headers/visibility.h"
+#include "headers/frustum.h"
+#include "headers/maths.h"
+
+void create_visibility(_app *p_app) {
+	p_app->visibility = (_app_visibility){0};
+	create_frustum(p_app);
+}
+
+// resolved bodies and impostors are first frustum culled on the cpu, so
+// nothing off screen is classified, uploaded or drawn. a body's bound
+// covers its mesh and its billboard quad
+static void cull_visibility(_app *p_app) {
+	u32 body_count = p_app->aggregate.resolved_count;
+	u32 impostor_count = p_app->aggregate.impostor_count;
+	u32 count = body_count + impostor_count;
+
+	mat4 view, proj;
+	camera_matrices(p_app, view, proj);
+	update_frustum(p_app, view, proj);
+	reserve_frustum(p_app, count);
+
+	_app_frustum *frustum = &p_app->frustum;
+	for (u32 r = 0; r < body_count; r++) {
+		_solar_object *obj = &p_app->obj.solar_objects[p_app->aggregate.resolved[r]];
+		float radius = obj->radius;
+		if (obj->billboard_index < p_app->obj.billboard_count) {
+			float *size = p_app->obj.billboards[obj->billboard_index].size;
+			radius = fmaxf(radius, 0.5f * sqrtf(size[0] * size[0] + size[1] * size[1]));
+		}
+		frustum->x[r] = obj->position[0];
+		frustum->y[r] = obj->position[1];
+		frustum->z[r] = obj->position[2];
+		frustum->r[r] = radius;
+	}
+	for (u32 i = 0; i < impostor_count; i++) {
+		_billboard *impostor = &p_app->aggregate.impostors[i];
+		frustum->x[body_count + i] = impostor->pos_w[0];
+		frustum->y[body_count + i] = impostor->pos_w[1];
+		frustum->z[body_count + i] = impostor->pos_w[2];
+		frustum->r[body_count + i] = 0.5f * sqrtf(impostor->size[0] * impostor->size[0] + impostor->size[1] * impostor->size[1]);
+	}
+
+	u32 visible_count = cull_frustum(p_app, count);
+
+	// visible indices are ascending, so bodies come first and the impostors
+	// can be closed up in place
+	p_app->visibility.body_count = 0;
+	u32 kept = 0;
+	for (u32 v = 0; v < visible_count; v++) {
+		u32 index = frustum->visible[v];
+		if (index < body_count) {
+			p_app->visibility.bodies[p_app->visibility.body_count++] = p_app->aggregate.resolved[index];
+		} else {
+			p_app->aggregate.impostors[kept++] = p_app->aggregate.impostors[index - body_count];
+		}
+	}
+	p_app->aggregate.impostor_count = kept;
+}
+
+// visible bodies whose projected radius is under config.visibility.point_pixels
+// are drawn as a single point list instead of a sphere each, the spheres are
+// left for the cull pass to bucket by lod
+void classify_visibility(_app *p_app) {
+	u32 count = p_app->aggregate.resolved_count;
+
+	if (count > p_app->visibility.capacity) {
+		p_app->visibility.bodies = realloc(p_app->visibility.bodies, sizeof(u32) * count * 2);
+		p_app->visibility.spheres = realloc(p_app->visibility.spheres, sizeof(u32) * count * 2);
+		p_app->visibility.points = realloc(p_app->visibility.points, sizeof(u32) * count * 2);
+		p_app->visibility.instances = realloc(p_app->visibility.instances, sizeof(u32) * count * 2);
+		p_app->visibility.capacity = count * 2;
+	}
+
+	cull_visibility(p_app);
+
+	p_app->visibility.sphere_count = 0;
+	p_app->visibility.point_count = 0;
+
+	float pixel_scale = (float)p_app->swp.extent.height / (2.0f * tanf(glm_rad(p_app->view.fov_y) * 0.5f));
+	float point_radius2 = p_app->config.visibility.point_pixels / pixel_scale;
+	point_radius2 *= point_radius2;
+
+	for (u32 v = 0; v < p_app->visibility.body_count; v++) {
+		u32 i = p_app->visibility.bodies[v];
+		_solar_object *obj = &p_app->obj.solar_objects[i];
+
+		// black holes always keep their mesh so the lens pass has a silhouette
+		if (obj->type == SOLAR_OBJECT_TYPE_BLACKHOLE) {
+			p_app->visibility.spheres[p_app->visibility.sphere_count++] = i;
+			continue;
+		}
+
+		float dist2 = glm_vec3_distance2(obj->position, p_app->view.camera_pos);
+		if (obj->radius * obj->radius < point_radius2 * dist2) {
+			p_app->visibility.points[p_app->visibility.point_count++] = i;
+		} else {
+			p_app->visibility.spheres[p_app->visibility.sphere_count++] = i;
+		}
+	}
+
+	// instances holds the sphere candidates followed by the points, the
+	// point draw reaches its part through firstVertex
+	u32 sphere_count = p_app->visibility.sphere_count;
+	if (sphere_count > 0)
+		memcpy(p_app->visibility.instances, p_app->visibility.spheres, sizeof(u32) * sphere_count);
+	if (p_app->visibility.point_count > 0)
+		memcpy(p_app->visibility.instances + sphere_count, p_app->visibility.points, sizeof(u32) * p_app->visibility.point_count);
+
+	p_app->visibility.point_first = sphere_count;
+	p_app->visibility.instance_count = sphere_count + p_app->visibility.point_count;
+}
+
+void destroy_visibility(_app *p_app) {
+	destroy_frustum(p_app);
+	free(p_app->visibility.bodies);
+	free(p_app->visibility.spheres);
+	free(p_app->visibility.points);
+	free(p_app->visibility.instances);
+	p_app->visibility = (_app_visibility){0};
+}
@@ -1,15 +1,27 @@
 #include "headers/window.h"
+#include "headers/bvh.h"
+#include "headers/lens.h"
 
-void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
-	_app *p_app = (_app*)glfwGetWindowUserPointer(window);
+// stamps the newest input for the latency estimate, glfw gives no event
+// times so this is when the event was delivered by a poll
+void note_input(_app *p_app) {
+	clock_gettime(CLOCK_MONOTONIC, &p_app->perf.input_time);
+	p_app->perf.input_pending = true;
+}
 
+// turns the camera by the cursor's movement since the last position seen,
+// false if it has not moved. the deltas telescope, so events polled after a
+// late sample still add up to the newest position
+bool turn_camera(_app *p_app, double xpos, double ypos) {
 	if (p_app->view.first_mouse) {
 		p_app->view.last_mouse_x = xpos;
 		p_app->view.last_mouse_y = ypos;
 		p_app->view.first_mouse = false;
-		return;
+		return false;
 	}
 
+	if (xpos == p_app->view.last_mouse_x && ypos == p_app->view.last_mouse_y) return false;
+
 	float dx = xpos - p_app->view.last_mouse_x;
 	float dy = p_app->view.last_mouse_y - ypos;
 
@@ -24,10 +36,67 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
 
 	if (p_app->view.pitch > 89.0f) p_app->view.pitch = 89.0f;
 	if (p_app->view.pitch < -89.0f) p_app->view.pitch = -89.0f;
+
+	return true;
+}
+
+void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
+	_app *p_app = (_app*)glfwGetWindowUserPointer(window);
+	note_input(p_app);
+	turn_camera(p_app, xpos, ypos);
+}
+
+void pick_focus(_app *p_app, double xpos, double ypos) {
+	int width, height;
+	glfwGetWindowSize(p_app->win.window, &width, &height);
+	if (width == 0 || height == 0) return;
+
+	vec3 front;
+	front[0] = cos(glm_rad(p_app->view.yaw)) * cos(glm_rad(p_app->view.pitch));
+	front[1] = sin(glm_rad(p_app->view.pitch));
+	front[2] = sin(glm_rad(p_app->view.yaw)) * cos(glm_rad(p_app->view.pitch));
+	glm_vec3_normalize(front);
+
+	vec3 right, up;
+	glm_vec3_cross(front, p_app->view.world_up, right);
+	glm_vec3_normalize(right);
+	glm_vec3_cross(right, front, up);
+
+	float tan_half_fov = tanf(glm_rad(p_app->view.fov_y) * 0.5f);
+	float aspect = (float)p_app->swp.extent.width / (float)p_app->swp.extent.height;
+	float ndc_x = 2.0f * (float)xpos / (float)width - 1.0f;
+	float ndc_y = 1.0f - 2.0f * (float)ypos / (float)height;
+
+	vec3 direction, tmp;
+	glm_vec3_copy(front, direction);
+	glm_vec3_scale(right, ndc_x * tan_half_fov * aspect, tmp);
+	glm_vec3_add(direction, tmp, direction);
+	glm_vec3_scale(up, ndc_y * tan_half_fov, tmp);
+	glm_vec3_add(direction, tmp, direction);
+	glm_vec3_normalize(direction);
+
+	u32 hit = bvh_ray_cast(p_app, p_app->view.camera_pos, direction, NULL);
+	if (hit != UINT32_MAX) {
+		p_app->view.focus_index = hit;
+	}
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
 	_app* p_app = (_app*)glfwGetWindowUserPointer(window);
+	note_input(p_app);
+
+	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+		if (p_app->view.mouse_locked) {
+			int width, height;
+			glfwGetWindowSize(window, &width, &height);
+			pick_focus(p_app, width * 0.5, height * 0.5);
+		} else {
+			double xpos, ypos;
+			glfwGetCursorPos(window, &xpos, &ypos);
+			pick_focus(p_app, xpos, ypos);
+		}
+		return;
+	}
 
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !p_app->view.mouse_locked) {
 		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -39,6 +108,17 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 	}
 }
 
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+	_app *p_app = (_app*)glfwGetWindowUserPointer(window);
+	if (action != GLFW_REPEAT) note_input(p_app);
+
+	// l steps the lens through its quality variants, a variant still
+	// compiling is switched to once it is ready
+	if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+		cycle_lens_quality(p_app);
+	}
+}
+
 void window_init(_app *p_app) {
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -50,6 +130,7 @@ void window_init(_app *p_app) {
 	glfwSetInputMode(p_app->win.window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetCursorPosCallback(p_app->win.window, mouse_callback);
 	glfwSetMouseButtonCallback(p_app->win.window, mouse_button_callback);
+	glfwSetKeyCallback(p_app->win.window, key_callback);
 }
 
 void framebuffer_resize_callback(GLFWwindow* window, int width, int height) {
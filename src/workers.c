@@ -0,0 +1,103 @@
+#include "headers/workers.h"
+
+static void take_worker_tasks(_app *p_app) {
+	_app_workers *workers = &p_app->workers;
+	for (u32 task; (task = atomic_fetch_add(&workers->next_task, 1)) < workers->task_count;) {
+		workers->task(p_app, task);
+	}
+}
+
+// parks until a run is handed out or the pool shuts down. every worker
+// reports back from every run, so none can miss a generation
+static void *worker_loop(void *arg) {
+	_app *p_app = arg;
+	_app_workers *workers = &p_app->workers;
+	uint64_t seen = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&workers->mutex);
+		while (workers->generation == seen && !workers->quit) {
+			pthread_cond_wait(&workers->wake, &workers->mutex);
+		}
+		if (workers->quit) {
+			pthread_mutex_unlock(&workers->mutex);
+			return NULL;
+		}
+		seen = workers->generation;
+		pthread_mutex_unlock(&workers->mutex);
+
+		take_worker_tasks(p_app);
+
+		pthread_mutex_lock(&workers->mutex);
+		if (--workers->running == 0) pthread_cond_signal(&workers->done);
+		pthread_mutex_unlock(&workers->mutex);
+	}
+}
+
+// the calling thread counts as one of the threads, a worker that fails to
+// start only leaves the others more to take
+void create_workers(_app *p_app) {
+	_app_workers *workers = &p_app->workers;
+	pthread_mutex_init(&workers->mutex, NULL);
+	pthread_cond_init(&workers->wake, NULL);
+	pthread_cond_init(&workers->done, NULL);
+	workers->count = 0;
+	workers->generation = 0;
+	workers->running = 0;
+	workers->quit = false;
+	atomic_init(&workers->next_task, 0);
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cores < 1) cores = 1;
+	if (cores > WORKER_MAX_THREADS) cores = WORKER_MAX_THREADS;
+
+	for (u32 t = 1; t < (u32)cores; t++) {
+		if (pthread_create(&workers->threads[workers->count], NULL, worker_loop, p_app) != 0) break;
+		workers->count++;
+	}
+}
+
+void destroy_workers(_app *p_app) {
+	_app_workers *workers = &p_app->workers;
+
+	pthread_mutex_lock(&workers->mutex);
+	workers->quit = true;
+	pthread_cond_broadcast(&workers->wake);
+	pthread_mutex_unlock(&workers->mutex);
+
+	for (u32 t = 0; t < workers->count; t++) {
+		pthread_join(workers->threads[t], NULL);
+	}
+	workers->count = 0;
+
+	pthread_mutex_destroy(&workers->mutex);
+	pthread_cond_destroy(&workers->wake);
+	pthread_cond_destroy(&workers->done);
+}
+
+// runs task over [0, count) on the workers and the calling thread and
+// returns once all of them have finished, inline when not worth a wake
+void run_worker_tasks(_app *p_app, _worker_task task, u32 count, bool threaded) {
+	_app_workers *workers = &p_app->workers;
+	if (!threaded || workers->count == 0 || count < 2) {
+		for (u32 t = 0; t < count; t++) task(p_app, t);
+		return;
+	}
+
+	pthread_mutex_lock(&workers->mutex);
+	workers->task = task;
+	workers->task_count = count;
+	atomic_store(&workers->next_task, 0);
+	workers->running = workers->count;
+	workers->generation++;
+	pthread_cond_broadcast(&workers->wake);
+	pthread_mutex_unlock(&workers->mutex);
+
+	take_worker_tasks(p_app);
+
+	pthread_mutex_lock(&workers->mutex);
+	while (workers->running > 0) {
+		pthread_cond_wait(&workers->done, &workers->mutex);
+	}
+	pthread_mutex_unlock(&workers->mutex);
+}